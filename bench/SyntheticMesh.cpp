@@ -0,0 +1,213 @@
+/*
+ Classy Voxelizer
+
+ BSD 2-Clause License
+ Copyright (c) 2018, Dario Rethage
+ See LICENSE at package root for full license
+ */
+
+#include <math.h>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+
+#include "tinyply.h"
+#include "SyntheticMesh.h"
+
+void SyntheticMesh::save(const std::string &filepath, bool binary) const {
+
+    std::vector<float> positions;
+    std::vector<uint8_t> rgb;
+    positions.reserve(3 * vertices.size());
+    rgb.reserve(3 * colors.size());
+
+    for (size_t i = 0; i < vertices.size(); i++) {
+        for (int channel = 0; channel < 3; channel++) {
+            positions.push_back(vertices[i][channel]);
+            rgb.push_back(colors[i][channel]);
+        }
+    }
+
+    std::vector<uint32_t> vertex_indices = faces;
+
+    tinyply::PlyFile output_file;
+    output_file.add_properties_to_element("vertex", { "x", "y", "z" }, positions);
+    output_file.add_properties_to_element("vertex", { "red", "green", "blue" }, rgb);
+    output_file.add_properties_to_element("face", { "vertex_indices" }, vertex_indices, 3, tinyply::PlyProperty::Type::UINT8);
+
+    std::ofstream ss(filepath, binary ? std::ios::binary : std::ios::out);
+    output_file.write(ss, binary);
+    ss.close();
+
+    if (!ss)
+        throw std::runtime_error("SyntheticMesh: could not write " + filepath);
+}
+
+PackedColor SyntheticMeshGenerator::getClassColor(int class_i) {
+    // 37 is odd, so the red channel alone tells classes 0 to 255 apart
+    return PackedColor((37 * class_i) & 255, (91 * class_i + 64) & 255, (173 * class_i + 128) & 255);
+}
+
+float SyntheticMeshGenerator::skewedCoordinate(int i, int num_cells, float size_skew) {
+
+    if (num_cells <= 1 || fabsf(size_skew - 1) < 1e-6f)
+        return (float) i / num_cells;
+
+    double growth = pow(size_skew, 1.0 / (num_cells - 1));
+    return (pow(growth, i) - 1) / (pow(growth, num_cells) - 1);
+}
+
+void SyntheticMeshGenerator::addPatch(SyntheticMesh &mesh, int cells_u, int cells_v, float size_skew, const Surface &surface, const std::function<PackedColor(const Eigen::Vector3f &)> &color_of) {
+
+    uint32_t base = mesh.vertices.size();
+
+    for (int j = 0; j <= cells_v; j++) {
+        for (int i = 0; i <= cells_u; i++) {
+            Eigen::Vector3f position = surface(skewedCoordinate(i, cells_u, size_skew), skewedCoordinate(j, cells_v, size_skew));
+            mesh.vertices.push_back(position);
+            mesh.colors.push_back(color_of(position));
+        }
+    }
+
+    for (int j = 0; j < cells_v; j++) {
+        for (int i = 0; i < cells_u; i++) {
+            uint32_t a = base + j * (cells_u + 1) + i;
+            uint32_t c = a + cells_u + 1;
+            mesh.faces.insert(mesh.faces.end(), { a, a + 1, c + 1, a, c + 1, c });
+        }
+    }
+}
+
+// Every side gets a share of num_faces by its area, in cells about as wide as they are high
+void SyntheticMeshGenerator::addBox(SyntheticMesh &mesh, Eigen::Vector3f min, Eigen::Vector3f max, uint64_t num_faces, float size_skew, const std::function<PackedColor(int)> &color_of_side) {
+
+    Eigen::Vector3f extent = max - min;
+    float area = 2 * (extent[0] * extent[1] + extent[1] * extent[2] + extent[0] * extent[2]);
+
+    for (int side = 0; side < 6; side++) {
+
+        int normal_axis = side / 2;
+        int a = (normal_axis + 1) % 3;
+        int b = (normal_axis + 2) % 3;
+        float side_faces = num_faces * extent[a] * extent[b] / area;
+        int cells_a = std::max(1, (int) roundf(sqrtf(side_faces / 2 * extent[a] / extent[b])));
+        int cells_b = std::max(1, (int) roundf(side_faces / 2 / cells_a));
+        float offset = (side % 2 == 0) ? min[normal_axis] : max[normal_axis];
+
+        addPatch(mesh, cells_a, cells_b, size_skew, [=](float u, float v) {
+            Eigen::Vector3f position;
+            position[normal_axis] = offset;
+            position[a] = min[a] + u * extent[a];
+            position[b] = min[b] + v * extent[b];
+            return position;
+        }, [&](const Eigen::Vector3f &) { return color_of_side(side); });
+    }
+}
+
+SyntheticMesh SyntheticMeshGenerator::sphere(uint64_t num_faces, float size_skew) {
+
+    const float radius = 5;
+    int cells_v = std::max(2, (int) round(sqrt(num_faces / 4.0)));
+
+    SyntheticMesh mesh;
+    addPatch(mesh, 2 * cells_v, cells_v, size_skew, [=](float u, float v) {
+        float theta = v * M_PI;
+        float phi = u * 2 * M_PI;
+        return Eigen::Vector3f(radius * sinf(theta) * cosf(phi), radius * sinf(theta) * sinf(phi), radius * cosf(theta));
+    }, [=](const Eigen::Vector3f &position) {
+        float theta = acosf(std::max(-1.0f, std::min(1.0f, position[2] / radius)));
+        return getClassColor(1 + std::min(7, (int) (theta / M_PI * 8)));
+    });
+
+    return mesh;
+}
+
+SyntheticMesh SyntheticMeshGenerator::terrain(uint64_t num_faces, float size_skew, uint32_t seed) {
+
+    const float size = 40;
+    const int num_waves = 4;
+    const float max_height = 3;
+
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> frequency(0.05f, 0.6f);
+    std::uniform_real_distribution<float> phase(0, 2 * M_PI);
+
+    // wave k: amplitude, x and y frequencies, x and y phases
+    std::vector<float> waves;
+    for (int k = 0; k < num_waves; k++)
+        waves.insert(waves.end(), { max_height / num_waves, frequency(random), frequency(random), phase(random), phase(random) });
+
+    int cells = std::max(1, (int) round(sqrt(num_faces / 2.0)));
+
+    SyntheticMesh mesh;
+    addPatch(mesh, cells, cells, size_skew, [=](float u, float v) {
+        float x = size * (u - 0.5f);
+        float y = size * (v - 0.5f);
+        float z = 0;
+        for (int k = 0; k < num_waves; k++)
+            z += waves[5 * k] * sinf(waves[5 * k + 1] * x + waves[5 * k + 3]) * cosf(waves[5 * k + 2] * y + waves[5 * k + 4]);
+        return Eigen::Vector3f(x, y, z);
+    }, [=](const Eigen::Vector3f &position) {
+        int band = (int) ((position[2] + max_height) / (2 * max_height) * 6);
+        return getClassColor(1 + std::max(0, std::min(5, band)));
+    });
+
+    return mesh;
+}
+
+// Walls, floor and ceiling take classes 1 to 3, furniture the others. Every surface gets a share of num_faces by its area.
+SyntheticMesh SyntheticMeshGenerator::room(uint64_t num_faces, float size_skew, int num_classes, uint32_t seed) {
+
+    const Eigen::Vector3f room_min(0, 0, 0);
+    const Eigen::Vector3f room_max(8, 6, 3);
+    const int num_objects = 30;
+
+    num_classes = std::max(1, std::min(255, num_classes));
+
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> unit(0, 1);
+    std::uniform_int_distribution<int> object_class(std::min(4, num_classes), num_classes);
+
+    struct Box {
+        Eigen::Vector3f min;
+        Eigen::Vector3f max;
+        PackedColor color;
+    };
+
+    std::vector<Box> boxes;
+    for (int i = 0; i < num_objects; i++) {
+
+        Eigen::Vector3f extent(0.3f + 1.2f * unit(random), 0.3f + 1.2f * unit(random), 0.3f + 0.9f * unit(random));
+        Eigen::Vector3f min(unit(random) * (room_max[0] - extent[0]), unit(random) * (room_max[1] - extent[1]), 0);
+
+        // some boxes stand on the one before, like a monitor on a desk
+        if (!boxes.empty() && unit(random) < 0.3f && boxes.back().max[2] + extent[2] < room_max[2]) {
+            extent.head<2>() = extent.head<2>().cwiseMin(boxes.back().max.head<2>() - boxes.back().min.head<2>());
+            min = boxes.back().min;
+            min[2] = boxes.back().max[2];
+        }
+
+        boxes.push_back({ min, min + extent, getClassColor(object_class(random)) });
+    }
+
+    auto areaOf = [](const Eigen::Vector3f &min, const Eigen::Vector3f &max) {
+        Eigen::Vector3f extent = max - min;
+        return 2 * (extent[0] * extent[1] + extent[1] * extent[2] + extent[0] * extent[2]);
+    };
+
+    float total_area = areaOf(room_min, room_max);
+    for (const Box &box : boxes)
+        total_area += areaOf(box.min, box.max);
+
+    SyntheticMesh mesh;
+
+    // the room is a box seen from inside, its sides colored as walls, floor (side 4) and ceiling (side 5)
+    addBox(mesh, room_min, room_max, num_faces * areaOf(room_min, room_max) / total_area, size_skew, [=](int side) {
+        return getClassColor(std::min((side < 4) ? 1 : side - 2, num_classes));
+    });
+
+    for (const Box &box : boxes)
+        addBox(mesh, box.min, box.max, num_faces * areaOf(box.min, box.max) / total_area, size_skew, [=](int) { return box.color; });
+
+    return mesh;
+}
@@ -0,0 +1,68 @@
+/*
+ Classy Voxelizer
+
+ BSD 2-Clause License
+ Copyright (c) 2018, Dario Rethage
+ See LICENSE at package root for full license
+ */
+
+#ifndef __SYNTHETICMESH__
+#define __SYNTHETICMESH__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <random>
+#include <functional>
+
+//Eigen
+#include <Eigen/Dense>
+
+#include "VoxelPayload.h"
+
+// A colored triangle mesh generated for benchmarks, in meters. Vertex colors stand for classes, so the mesh
+// voxelizes with every color mapping but labels.
+struct SyntheticMesh {
+    std::vector<Eigen::Vector3f> vertices;
+    std::vector<uint32_t> faces;
+    std::vector<PackedColor> colors;
+
+    uint64_t getNumFaces() const { return faces.size() / 3; }
+
+    // Writes x, y, z, red, green, blue vertices and vertex_indices faces; throws if the file can't be written
+    void save(const std::string &filepath, bool binary) const;
+};
+
+// Generates meshes of about num_faces faces from regular patches of cells, two triangles each.
+// size_skew sets the triangle size distribution: cells grow geometrically along every patch, the last one size_skew
+// times the size of the first, so 1 gives uniform triangles and larger values mix many small and few large ones.
+class SyntheticMeshGenerator {
+public:
+    // A sphere of 5 m radius in 8 latitude bands of color
+    static SyntheticMesh sphere(uint64_t num_faces, float size_skew);
+
+    // A 40 x 40 m height field of random waves, colored in 6 height bands
+    static SyntheticMesh terrain(uint64_t num_faces, float size_skew, uint32_t seed);
+
+    // An 8 x 6 x 3 m room, like a ScanNet scan: floor, walls and ceiling, and boxes of furniture standing on the floor
+    // or on each other, each with one of num_classes class colors (at most 255)
+    static SyntheticMesh room(uint64_t num_faces, float size_skew, int num_classes, uint32_t seed);
+
+    // Color of class class_i, distinct for classes 1 to 255
+    static PackedColor getClassColor(int class_i);
+
+private:
+    typedef std::function<Eigen::Vector3f(float, float)> Surface;
+
+    // Adds cells_u x cells_v cells over the surface at (u, v) in [0, 1]^2
+    static void addPatch(SyntheticMesh &mesh, int cells_u, int cells_v, float size_skew, const Surface &surface, const std::function<PackedColor(const Eigen::Vector3f &)> &color_of);
+    // Adds the sides of an axis-aligned box in about num_faces faces, side 2 * axis on the min and 2 * axis + 1 on the
+    // max end of that axis
+    static void addBox(SyntheticMesh &mesh, Eigen::Vector3f min, Eigen::Vector3f max, uint64_t num_faces, float size_skew, const std::function<PackedColor(int)> &color_of_side);
+    // Position in [0, 1] of grid line i of num_cells, with cells growing by size_skew from first to last
+    static float skewedCoordinate(int i, int num_cells, float size_skew);
+};
+
+#endif /* defined(__SYNTHETICMESH__) */
@@ -0,0 +1,268 @@
+/*
+ Classy Voxelizer
+
+ BSD 2-Clause License
+ Copyright (c) 2018, Dario Rethage
+ See LICENSE at package root for full license
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <stdexcept>
+
+#include "MeshReader.h"
+#include "MultiClassVoxelizer.h"
+#include "SyntheticMesh.h"
+
+// Scaling benchmark of the voxelization pipeline on synthetic meshes. Every mesh is generated once and saved as binary
+// PLY; every combination of voxel size and thread count then times parsing (readPlyWithClass, which also bounds the
+// vertices), voxelization and export (saveAsPLY) separately, as the color mapping does.
+// Results go to a JSON file, one record per run.
+
+struct BenchOptions {
+    std::vector<std::string> shapes = {"sphere", "terrain", "room"};
+    std::vector<uint64_t> face_counts = {100000, 1000000};
+    std::vector<double> voxel_sizes = {0.1, 0.05, 0.02};
+    std::vector<unsigned int> thread_counts = {1, 0};
+    float size_skew = 1;
+    int num_classes = 40;
+    int num_repeats = 1;
+    bool overlap_engine = false;
+    bool sparse_storage = false;
+    std::string output_filepath = "bench.json";
+    std::string work_dir = ".";
+};
+
+struct BenchRun {
+    std::string shape;
+    uint64_t target_faces;
+    uint64_t num_faces;
+    uint64_t num_vertices;
+    double voxel_size;
+    unsigned int num_threads;
+    int repeat;
+    uint64_t num_voxels;
+    uint64_t num_occupied;
+    uint64_t output_bytes;
+    double parse_seconds;
+    double voxelize_seconds;
+    double export_seconds;
+};
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+template <typename T>
+std::vector<T> parseList(const std::string &list) {
+
+    std::vector<T> values;
+    std::istringstream fields(list);
+    std::string field;
+
+    while (std::getline(fields, field, ',')) {
+        std::istringstream value_field(field);
+        T value;
+        if (!(value_field >> value))
+            throw std::runtime_error("bad list: " + list);
+        values.push_back(value);
+    }
+
+    return values;
+}
+
+SyntheticMesh generateMesh(const std::string &shape, uint64_t num_faces, const BenchOptions &options) {
+
+    if (shape == "sphere")
+        return SyntheticMeshGenerator::sphere(num_faces, options.size_skew);
+    if (shape == "terrain")
+        return SyntheticMeshGenerator::terrain(num_faces, options.size_skew, 1);
+    if (shape == "room")
+        return SyntheticMeshGenerator::room(num_faces, options.size_skew, options.num_classes, 1);
+
+    throw std::runtime_error("unknown shape: " + shape);
+}
+
+// Voxelizes and exports, filling the voxelize and export fields of run
+template <typename Storage>
+void voxelizeAndExport(const std::vector<Eigen::Vector3f> &vertices, const std::vector<uint32_t> &faces, const std::vector<uint8_t> &classes, const std::vector<Eigen::Vector3i> &colormap,
+                       Eigen::Vector3f min, Eigen::Vector3f max, const std::string &output_filepath, const BenchOptions &options, BenchRun &run) {
+
+    typedef Voxelizer<uint8_t, LastWriteReducer<uint8_t>, Storage> ClassVoxelizer;
+
+    auto start = std::chrono::steady_clock::now();
+    VoxelGrid<uint8_t, Storage> voxel_grid = options.overlap_engine
+        ? ClassVoxelizer::voxelizeOverlap(vertices, faces, classes, min, max, run.voxel_size, TriangleVoxelCoverage::CONSERVATIVE, run.num_threads)
+        : ClassVoxelizer::voxelize(vertices, faces, classes, min, max, run.voxel_size, run.num_threads);
+    run.voxelize_seconds = secondsSince(start);
+
+    run.num_voxels = voxel_grid.getVoxelsPerDim().template cast<int64_t>().prod();
+    run.num_occupied = voxel_grid.getNumOccupied();
+
+    start = std::chrono::steady_clock::now();
+    voxel_grid.saveAsPLY(output_filepath, colormap, false);
+    run.export_seconds = secondsSince(start);
+
+    std::ifstream output_file(output_filepath, std::ios::binary | std::ios::ate);
+    run.output_bytes = output_file.tellg();
+}
+
+BenchRun runOnce(const std::string &mesh_filepath, const std::string &output_filepath, const BenchOptions &options, BenchRun run) {
+
+    std::vector<Eigen::Vector3f> vertices;
+    std::vector<uint32_t> faces;
+    std::vector<uint8_t> classes;
+    std::vector<Eigen::Vector3i> colormap;
+
+    Eigen::Vector3f min, max;
+
+    auto start = std::chrono::steady_clock::now();
+    if (!readPlyWithClass(mesh_filepath, vertices, min, max, &faces, classes, colormap, run.num_threads))
+        throw std::runtime_error("could not map the colors of " + mesh_filepath + " to classes");
+    run.parse_seconds = secondsSince(start);
+
+    getVoxelSpaceDimensions(run.voxel_size, min, max);
+
+    if (options.sparse_storage)
+        voxelizeAndExport<SparseVoxelStorage<uint8_t>>(vertices, faces, classes, colormap, min, max, output_filepath, options, run);
+    else
+        voxelizeAndExport<DenseVoxelStorage<uint8_t>>(vertices, faces, classes, colormap, min, max, output_filepath, options, run);
+
+    return run;
+}
+
+void writeJSON(const std::string &filepath, const BenchOptions &options, const std::vector<BenchRun> &runs) {
+
+    std::ofstream output_file(filepath);
+
+    output_file << "{\n"
+                << "  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n"
+                << "  \"engine\": \"" << (options.overlap_engine ? "sat" : "split") << "\",\n"
+                << "  \"storage\": \"" << (options.sparse_storage ? "sparse" : "dense") << "\",\n"
+                << "  \"size_skew\": " << options.size_skew << ",\n"
+                << "  \"runs\": [";
+
+    for (size_t i = 0; i < runs.size(); i++) {
+        const BenchRun &run = runs[i];
+        output_file << (i == 0 ? "\n" : ",\n")
+                    << "    {\"shape\": \"" << run.shape << "\", \"target_faces\": " << run.target_faces << ", \"faces\": " << run.num_faces
+                    << ", \"vertices\": " << run.num_vertices << ", \"voxel_size\": " << run.voxel_size << ", \"threads\": " << run.num_threads
+                    << ", \"repeat\": " << run.repeat << ", \"voxels\": " << run.num_voxels << ", \"occupied_voxels\": " << run.num_occupied
+                    << ", \"output_bytes\": " << run.output_bytes << ", \"seconds\": {\"parse\": " << run.parse_seconds
+                    << ", \"voxelize\": " << run.voxelize_seconds
+                    << ", \"export\": " << run.export_seconds << "}}";
+    }
+
+    output_file << "\n  ]\n}\n";
+    output_file.close();
+
+    if (!output_file)
+        throw std::runtime_error("could not write " + filepath);
+}
+
+int main(int argc, char* argv[]) {
+
+    std::string usage_message = "\nUsage:\n\n./classy_voxelizer_bench [options]"
+                                "\n\nOptions:\n\n"
+                                "  --output <file>           JSON results (default: bench.json)\n"
+                                "  --work-dir <dir>          where generated meshes and exports are written (default: .)\n"
+                                "  --shapes <list>           comma-separated sphere, terrain, room (default: all)\n"
+                                "  --faces <list>            face counts of the generated meshes (default: 100000,1000000)\n"
+                                "  --voxel-sizes <list>      voxel sizes in meters (default: 0.1,0.05,0.02)\n"
+                                "  --threads <list>          thread counts, 0 for all hardware threads (default: 1,0)\n"
+                                "  --skew <s>                the largest triangles of every surface are s times the size of the smallest (default: 1)\n"
+                                "  --classes <n>             classes of the room shape (default: 40)\n"
+                                "  --repeats <n>             runs of every combination (default: 1)\n"
+                                "  --engine <split|sat>      voxelization engine (default: split)\n"
+                                "  --storage <dense|sparse>  voxel storage (default: dense)";
+
+    BenchOptions options;
+
+    try {
+        for (int arg_i = 1; arg_i < argc; arg_i++) {
+
+            std::string option = argv[arg_i];
+            if (option == "--help") {
+                std::cout << usage_message << std::endl;
+                return 0;
+            }
+
+            if (arg_i + 1 >= argc) {
+                std::cout << "Unknown option: " << option << std::endl << usage_message << std::endl;
+                return 1;
+            }
+
+            std::string value = argv[++arg_i];
+
+            if (option == "--output")
+                options.output_filepath = value;
+            else if (option == "--work-dir")
+                options.work_dir = value;
+            else if (option == "--shapes")
+                options.shapes = parseList<std::string>(value);
+            else if (option == "--faces")
+                options.face_counts = parseList<uint64_t>(value);
+            else if (option == "--voxel-sizes")
+                options.voxel_sizes = parseList<double>(value);
+            else if (option == "--threads")
+                options.thread_counts = parseList<unsigned int>(value);
+            else if (option == "--skew")
+                options.size_skew = std::stof(value);
+            else if (option == "--classes")
+                options.num_classes = std::stoi(value);
+            else if (option == "--repeats")
+                options.num_repeats = std::stoi(value);
+            else if (option == "--engine" && (value == "split" || value == "sat"))
+                options.overlap_engine = (value == "sat");
+            else if (option == "--storage" && (value == "dense" || value == "sparse"))
+                options.sparse_storage = (value == "sparse");
+            else {
+                std::cout << "Unknown option: " << option << std::endl << usage_message << std::endl;
+                return 1;
+            }
+        }
+
+        std::vector<BenchRun> runs;
+        std::string output_filepath = options.work_dir + "/bench_voxels.ply";
+
+        for (const std::string &shape : options.shapes) {
+            for (uint64_t target_faces : options.face_counts) {
+
+                std::string mesh_filepath = options.work_dir + "/bench_" + shape + "_" + std::to_string(target_faces) + ".ply";
+                SyntheticMesh mesh = generateMesh(shape, target_faces, options);
+                mesh.save(mesh_filepath, true);
+
+                for (double voxel_size : options.voxel_sizes) {
+                    for (unsigned int num_threads : options.thread_counts) {
+                        for (int repeat = 0; repeat < options.num_repeats; repeat++) {
+
+                            BenchRun run = {shape, target_faces, mesh.getNumFaces(), mesh.vertices.size(), voxel_size, resolveNumThreads(num_threads), repeat};
+                            run = runOnce(mesh_filepath, output_filepath, options, run);
+                            runs.push_back(run);
+
+                            std::cout << shape << " " << run.num_faces << " faces, voxel size " << voxel_size << ", " << run.num_threads << " threads: parse "
+                                      << run.parse_seconds << " s, voxelize " << run.voxelize_seconds
+                                      << " s, export " << run.export_seconds << " s" << std::endl;
+                        }
+                    }
+                }
+
+                remove(mesh_filepath.c_str());
+            }
+        }
+
+        remove(output_filepath.c_str());
+        writeJSON(options.output_filepath, options, runs);
+
+    } catch (const std::exception &e) {
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
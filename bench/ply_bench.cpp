@@ -0,0 +1,315 @@
+/*
+ Classy Voxelizer
+
+ BSD 2-Clause License
+ Copyright (c) 2018, Dario Rethage
+ See LICENSE at package root for full license
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <stdexcept>
+
+#include "tinyply.h"
+
+// Throughput microbenchmark of tinyply::PlyFile::read and write in isolation. Files of random vertices and faces
+// are written in every format and vertex layout, then read back in full and with partial requests, through the
+// stream and the file path (memory-mapped) entry points. Every case reports MB/s and records/s as JSON.
+// tinyply only writes little-endian binary, so big-endian files are written here byte-swapped and only read back.
+
+// Vertex properties of a layout: x, y, z floats, then red, green, blue uchars, then a ushort label
+struct Layout {
+    std::string name;
+    bool colors;
+    bool labels;
+};
+
+// Random mesh data, vertex properties in separate arrays like the ones tinyply reads into
+struct PlyData {
+    std::vector<float> positions;
+    std::vector<uint8_t> colors;
+    std::vector<uint16_t> labels;
+    std::vector<int32_t> faces;
+
+    size_t getNumVertices() const { return positions.size() / 3; }
+    size_t getNumFaces() const { return faces.size() / 3; }
+};
+
+struct PlyBenchOptions {
+    uint64_t num_vertices = 1000000;
+    int num_repeats = 3;
+    std::string output_filepath = "ply_bench.json";
+    std::string work_dir = ".";
+};
+
+// One timed case; records are the vertices and faces read or written
+struct PlyBenchCase {
+    std::string operation;
+    std::string format;
+    std::string layout;
+    std::string request;
+    std::string entry_point;
+    uint64_t bytes;
+    uint64_t records;
+    std::vector<double> seconds;
+};
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+uint64_t getFileSize(const std::string &filepath) {
+    std::ifstream file(filepath, std::ios::binary | std::ios::ate);
+    return file ? (uint64_t) file.tellg() : 0;
+}
+
+// Faces join random vertices; there are twice as many faces as vertices, as in closed meshes
+PlyData generateData(uint64_t num_vertices) {
+
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> coordinate(-10, 10);
+    std::uniform_int_distribution<int> channel(0, 255);
+    std::uniform_int_distribution<int> label(0, 40);
+    std::uniform_int_distribution<int32_t> vertex(0, std::max<int64_t>(0, (int64_t) num_vertices - 1));
+
+    PlyData data;
+    for (uint64_t i = 0; i < num_vertices; i++) {
+        for (int j = 0; j < 3; j++) {
+            data.positions.push_back(coordinate(random));
+            data.colors.push_back(channel(random));
+        }
+        data.labels.push_back(label(random));
+    }
+
+    for (uint64_t i = 0; i < 6 * num_vertices; i++)
+        data.faces.push_back(vertex(random));
+
+    return data;
+}
+
+// Writes through tinyply, returns the seconds taken
+double writeWithTinyply(PlyData data, const Layout &layout, bool binary, const std::string &filepath) {
+
+    tinyply::PlyFile output_file;
+    output_file.add_properties_to_element("vertex", { "x", "y", "z" }, data.positions);
+    if (layout.colors)
+        output_file.add_properties_to_element("vertex", { "red", "green", "blue" }, data.colors);
+    if (layout.labels)
+        output_file.add_properties_to_element("vertex", { "label" }, data.labels);
+    output_file.add_properties_to_element("face", { "vertex_indices" }, data.faces, 3, tinyply::PlyProperty::Type::UINT8);
+
+    auto start = std::chrono::steady_clock::now();
+    std::ofstream ss(filepath, binary ? std::ios::binary : std::ios::out);
+    output_file.write(ss, binary);
+    ss.close();
+    double seconds = secondsSince(start);
+
+    if (!ss)
+        throw std::runtime_error("could not write " + filepath);
+
+    return seconds;
+}
+
+template <typename T>
+void writeBigEndian(std::ostream &os, T value) {
+    char bytes[sizeof(T)];
+    memcpy(bytes, &value, sizeof(T));
+    std::reverse(bytes, bytes + sizeof(T));
+    os.write(bytes, sizeof(T));
+}
+
+// The same file as writeWithTinyply in binary_big_endian, for the read cases
+void writeBigEndianFile(const PlyData &data, const Layout &layout, const std::string &filepath) {
+
+    std::ofstream ss(filepath, std::ios::binary);
+
+    ss << "ply\nformat binary_big_endian 1.0\nelement vertex " << data.getNumVertices()
+       << "\nproperty float x\nproperty float y\nproperty float z\n";
+    if (layout.colors)
+        ss << "property uchar red\nproperty uchar green\nproperty uchar blue\n";
+    if (layout.labels)
+        ss << "property ushort label\n";
+    ss << "element face " << data.getNumFaces() << "\nproperty list uchar int vertex_indices\nend_header\n";
+
+    for (size_t i = 0; i < data.getNumVertices(); i++) {
+        for (int j = 0; j < 3; j++)
+            writeBigEndian(ss, data.positions[3 * i + j]);
+        if (layout.colors)
+            ss.write(reinterpret_cast<const char *>(&data.colors[3 * i]), 3);
+        if (layout.labels)
+            writeBigEndian(ss, data.labels[i]);
+    }
+
+    for (size_t i = 0; i < data.getNumFaces(); i++) {
+        ss.put(3);
+        for (int j = 0; j < 3; j++)
+            writeBigEndian(ss, data.faces[3 * i + j]);
+    }
+
+    ss.close();
+    if (!ss)
+        throw std::runtime_error("could not write " + filepath);
+}
+
+// Reads what request asks for: "all" properties of both elements, "vertices" (all vertex properties, faces skipped),
+// "xyz" (positions only, the rest of the file skipped) or "faces" (face lists only). Returns the seconds taken and the
+// records read.
+double readWithTinyply(const std::string &filepath, const Layout &layout, const std::string &request, bool mapped, uint64_t &num_records) {
+
+    std::vector<float> positions;
+    std::vector<uint8_t> colors;
+    std::vector<uint16_t> labels;
+    std::vector<int32_t> faces;
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::ifstream ss(filepath, std::ios::binary);
+    tinyply::PlyFile input_file(ss);
+
+    num_records = 0;
+    if (request != "faces")
+        num_records += input_file.request_properties_from_element("vertex", { "x", "y", "z" }, positions);
+    if (request == "all" || request == "vertices") {
+        if (layout.colors)
+            input_file.request_properties_from_element("vertex", { "red", "green", "blue" }, colors);
+        if (layout.labels)
+            input_file.request_properties_from_element("vertex", { "label" }, labels);
+    }
+    if (request == "all" || request == "faces")
+        num_records += input_file.request_properties_from_element("face", { "vertex_indices" }, faces, 3);
+
+    if (mapped)
+        input_file.read(ss, filepath);
+    else
+        input_file.read(ss);
+
+    return secondsSince(start);
+}
+
+void writeJSON(const std::string &filepath, const PlyBenchOptions &options, const std::vector<PlyBenchCase> &cases) {
+
+    std::ofstream output_file(filepath);
+
+    output_file << "{\n"
+                << "  \"vertices\": " << options.num_vertices << ",\n"
+                << "  \"faces\": " << 2 * options.num_vertices << ",\n"
+                << "  \"repeats\": " << options.num_repeats << ",\n"
+                << "  \"cases\": [";
+
+    for (size_t i = 0; i < cases.size(); i++) {
+
+        const PlyBenchCase &bench_case = cases[i];
+        double best_seconds = *std::min_element(bench_case.seconds.begin(), bench_case.seconds.end());
+
+        output_file << (i == 0 ? "\n" : ",\n")
+                    << "    {\"operation\": \"" << bench_case.operation << "\", \"format\": \"" << bench_case.format << "\", \"layout\": \"" << bench_case.layout
+                    << "\", \"request\": \"" << bench_case.request << "\", \"entry_point\": \"" << bench_case.entry_point
+                    << "\", \"bytes\": " << bench_case.bytes << ", \"records\": " << bench_case.records << ", \"seconds\": [";
+        for (size_t j = 0; j < bench_case.seconds.size(); j++)
+            output_file << (j == 0 ? "" : ", ") << bench_case.seconds[j];
+        output_file << "], \"best_mb_per_s\": " << bench_case.bytes / 1e6 / best_seconds
+                    << ", \"best_records_per_s\": " << bench_case.records / best_seconds << "}";
+    }
+
+    output_file << "\n  ]\n}\n";
+    output_file.close();
+
+    if (!output_file)
+        throw std::runtime_error("could not write " + filepath);
+}
+
+void report(const PlyBenchCase &bench_case) {
+
+    double best_seconds = *std::min_element(bench_case.seconds.begin(), bench_case.seconds.end());
+    std::cout << bench_case.operation << " " << bench_case.format << " " << bench_case.layout << " " << bench_case.request << " "
+              << bench_case.entry_point << ": " << bench_case.bytes / 1e6 / best_seconds << " MB/s, "
+              << bench_case.records / best_seconds << " records/s" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+
+    std::string usage_message = "\nUsage:\n\n./classy_voxelizer_ply_bench [options]"
+                                "\n\nOptions:\n\n"
+                                "  --output <file>           JSON results (default: ply_bench.json)\n"
+                                "  --work-dir <dir>          where the PLY files are written (default: .)\n"
+                                "  --vertices <n>            vertices per file, with twice as many faces (default: 1000000)\n"
+                                "  --repeats <n>             runs of every case, the best one is reported (default: 3)";
+
+    PlyBenchOptions options;
+
+    for (int arg_i = 1; arg_i < argc; arg_i++) {
+
+        std::string option = argv[arg_i];
+
+        if (option == "--output" && arg_i + 1 < argc) {
+            options.output_filepath = argv[++arg_i];
+        } else if (option == "--work-dir" && arg_i + 1 < argc) {
+            options.work_dir = argv[++arg_i];
+        } else if (option == "--vertices" && arg_i + 1 < argc) {
+            options.num_vertices = std::stoull(argv[++arg_i]);
+        } else if (option == "--repeats" && arg_i + 1 < argc && std::stoi(argv[arg_i + 1]) >= 1) {
+            options.num_repeats = std::stoi(argv[++arg_i]);
+        } else {
+            std::cout << usage_message << std::endl;
+            return option == "--help" ? 0 : 1;
+        }
+    }
+
+    const std::vector<Layout> layouts = { {"xyz", false, false}, {"xyz_rgb", true, false}, {"xyz_rgb_label", true, true} };
+    const std::vector<std::string> formats = { "ascii", "binary_little_endian", "binary_big_endian" };
+    const std::vector<std::string> requests = { "all", "vertices", "xyz", "faces" };
+
+    std::vector<PlyBenchCase> cases;
+
+    try {
+        PlyData data = generateData(options.num_vertices);
+        uint64_t num_records = data.getNumVertices() + data.getNumFaces();
+
+        for (const Layout &layout : layouts) {
+            for (const std::string &format : formats) {
+
+                std::string filepath = options.work_dir + "/ply_bench_" + layout.name + "_" + format + ".ply";
+
+                if (format == "binary_big_endian") {
+                    writeBigEndianFile(data, layout, filepath);
+                } else {
+                    PlyBenchCase bench_case = {"write", format, layout.name, "all", "stream", 0, num_records};
+                    for (int repeat = 0; repeat < options.num_repeats; repeat++)
+                        bench_case.seconds.push_back(writeWithTinyply(data, layout, format != "ascii", filepath));
+                    bench_case.bytes = getFileSize(filepath);
+                    report(bench_case);
+                    cases.push_back(bench_case);
+                }
+
+                for (const std::string &request : requests) {
+                    for (bool mapped : {false, true}) {
+
+                        PlyBenchCase bench_case = {"read", format, layout.name, request, mapped ? "path" : "stream", getFileSize(filepath), 0};
+                        for (int repeat = 0; repeat < options.num_repeats; repeat++)
+                            bench_case.seconds.push_back(readWithTinyply(filepath, layout, request, mapped, bench_case.records));
+                        report(bench_case);
+                        cases.push_back(bench_case);
+                    }
+                }
+
+                remove(filepath.c_str());
+            }
+        }
+
+        writeJSON(options.output_filepath, options, cases);
+
+    } catch (const std::exception &e) {
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
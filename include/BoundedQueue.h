@@ -0,0 +1,81 @@
+/*
+ Classy Voxelizer
+
+ BSD 2-Clause License
+ Copyright (c) 2018, Dario Rethage
+ See LICENSE at package root for full license
+ */
+
+#ifndef __BOUNDEDQUEUE__
+#define __BOUNDEDQUEUE__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+// A FIFO between pipeline stages holding at most capacity items. push() blocks while the queue is full,
+// so a fast producer waits for its consumers instead of piling up items. Once the producers are done
+// they close() the queue; pop() then drains the remaining items and returns false.
+template <typename T>
+class BoundedQueue {
+public:
+    BoundedQueue(size_t capacity) : _capacity(capacity > 0 ? capacity : 1), _closed(false) {}
+
+    // Returns false, dropping the item, if the queue was closed
+    bool push(T item);
+
+    // Blocks until an item is available, returns false once the queue is closed and empty
+    bool pop(T &item);
+
+    void close();
+
+private:
+    size_t _capacity;
+    bool _closed;
+    std::deque<T> _items;
+    std::mutex _mutex;
+    std::condition_variable _not_full;
+    std::condition_variable _not_empty;
+};
+
+template <typename T>
+bool BoundedQueue<T>::push(T item) {
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _not_full.wait(lock, [&]() { return _closed || _items.size() < _capacity; });
+
+    if (_closed)
+        return false;
+
+    _items.push_back(std::move(item));
+    _not_empty.notify_one();
+    return true;
+}
+
+template <typename T>
+bool BoundedQueue<T>::pop(T &item) {
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _not_empty.wait(lock, [&]() { return _closed || !_items.empty(); });
+
+    if (_items.empty())
+        return false;
+
+    item = std::move(_items.front());
+    _items.pop_front();
+    _not_full.notify_one();
+    return true;
+}
+
+template <typename T>
+void BoundedQueue<T>::close() {
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _closed = true;
+    _not_full.notify_all();
+    _not_empty.notify_all();
+}
+
+#endif /* defined(__BOUNDEDQUEUE__) */
@@ -0,0 +1,44 @@
+/*
+ Classy Voxelizer
+
+ BSD 2-Clause License
+ Copyright (c) 2018, Dario Rethage
+ See LICENSE at package root for full license
+ */
+
+#ifndef __COLORCLASSMAPPER__
+#define __COLORCLASSMAPPER__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+//Eigen
+#include <Eigen/Dense>
+
+#include "VoxelPayload.h"
+
+// Vertices below this count are mapped on a single thread
+#define COLORCLASSMAPPER_MIN_COLORS_PER_THREAD (1 << 16)
+
+// Maps vertex colors to classes for the color mapping. Class i + 1 is colormap[i], class 0 is left for empty voxels.
+// Colors are packed into 24 bits and looked up in a direct table of 2^24 class ids, instead of searching the colormap.
+class ColorClassMapper {
+public:
+    // Reads a palette of one "red green blue" color per line, the color on line i becoming class i + 1.
+    // Blank lines and lines starting with '#' are skipped.
+    static bool loadPalette(const std::string &filepath, std::vector<Eigen::Vector3i> &colormap);
+
+    // Colors already in colormap keep their class, the others are appended to it in the order they first appear,
+    // whatever the number of threads. False if that takes more than 255 classes.
+    static bool mapColors(const PackedColor *colors, size_t num_colors, std::vector<Eigen::Vector3i> &colormap, uint8_t *classes, unsigned int num_threads);
+
+private:
+    static uint32_t pack(const PackedColor &color) { return color[0] | (color[1] << 8) | (color[2] << 16); }
+    static uint32_t pack(const Eigen::Vector3i &color) { return (color[0] & 255) | ((color[1] & 255) << 8) | ((color[2] & 255) << 16); }
+
+};
+
+#endif /* defined(__COLORCLASSMAPPER__) */
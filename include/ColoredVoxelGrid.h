@@ -9,40 +9,9 @@
 #ifndef __ColoredVOXELGRID__
 #define __ColoredVOXELGRID__
 
-#include <stdio.h>
-#include <stdlib.h>
-#include <iostream>
-#include <fstream>
-#include <vector>
+#include "VoxelGrid.h"
 
-//Eigen
-#include <Eigen/Dense>
-
-#include "tinyply.h"
-
-class ColoredVoxelGrid {
-public:
-    ColoredVoxelGrid(Eigen::Vector3f grid_min, Eigen::Vector3f grid_max, float voxel_size);
-    int getEnclosingVoxelID(Eigen::Vector3f vertex);
-    Eigen::Vector3i getVoxelsPerDim();
-    void setVoxelColor(uint32_t voxel_id, Eigen::Vector3i color);
-    Eigen::Vector3i getVoxelColor(uint32_t voxel_id);
-    std::vector<Eigen::Vector3i> getVoxelGrid();
-    void saveAsRAW(std::string filepath);
-    void saveAsPLY(std::string filepath, bool dense);
-	bool isVoxelOccupied(uint32_t voxel_id);
-	bool isVoxelOccupied(Eigen::Vector3f vertex);
-	unsigned int getNumOccupied();
-    
-private:
-    Eigen::Vector3i _voxels_per_dim;
-    Eigen::Vector3f _grid_min;
-    Eigen::Vector3f _grid_max;
-    Eigen::Vector3f _grid_size;
-    float _voxel_size;
-    std::vector<Eigen::Vector3i> _voxelgrid;
-    uint32_t _num_voxels;
-    
-};
+// Voxel grid of packed RGB colors, 4 bytes per voxel
+typedef VoxelGrid<PackedColor> ColoredVoxelGrid;
 
 #endif /* defined(__ColoredVOXELGRID__) */
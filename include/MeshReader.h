@@ -0,0 +1,43 @@
+/*
+ Classy Voxelizer
+
+ BSD 2-Clause License
+ Copyright (c) 2018, Dario Rethage
+ See LICENSE at package root for full license
+ */
+
+#ifndef __MESHREADER__
+#define __MESHREADER__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <functional>
+
+//Eigen
+#include <Eigen/Dense>
+
+#include "VoxelPayload.h"
+
+// Readers of PLY meshes for the three color mappings. Every reader fills the vertices and their bounding box in
+// min and max, the faces as three vertex indices each unless faces is null, and one payload per vertex.
+
+// Classes from a "label" vertex property (labels mapping)
+bool readPlyWithLabelProperties(std::string filepath, std::vector<Eigen::Vector3f> &vertices, Eigen::Vector3f &min, Eigen::Vector3f &max, std::vector<uint32_t> *faces, std::vector<uint8_t> &classes, std::vector<Eigen::Vector3i> &colormap);
+
+// Classes from the vertex colors (color mapping), mapped on num_threads threads; see ColorClassMapper::mapColors
+bool readPlyWithClass(std::string filepath, std::vector<Eigen::Vector3f> &vertices, Eigen::Vector3f &min, Eigen::Vector3f &max, std::vector<uint32_t> *faces, std::vector<uint8_t> &classes, std::vector<Eigen::Vector3i> &colormap, unsigned int num_threads);
+
+// The vertex colors themselves (none mapping)
+bool readPlyWithColor(std::string filepath, std::vector<Eigen::Vector3f> &vertices, Eigen::Vector3f &min, Eigen::Vector3f &max, std::vector<uint32_t> *faces, std::vector<PackedColor> &colors);
+
+// Streams the faces of a mesh to on_faces, faces_per_chunk of them at a time, so they are never all in memory.
+// For meshes whose vertices were read with null faces.
+bool readPlyFaces(std::string filepath, size_t faces_per_chunk, const std::function<void(const std::vector<uint32_t> &faces)> &on_faces);
+
+// Pads the bounding box a reader computed by one voxel on each side
+void getVoxelSpaceDimensions(const double voxel_size, Eigen::Vector3f &min, Eigen::Vector3f &max);
+
+#endif /* defined(__MESHREADER__) */
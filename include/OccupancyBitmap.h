@@ -0,0 +1,129 @@
+/*
+ Classy Voxelizer
+
+ BSD 2-Clause License
+ Copyright (c) 2018, Dario Rethage
+ See LICENSE at package root for full license
+ */
+
+#ifndef __OCCUPANCYBITMAP__
+#define __OCCUPANCYBITMAP__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+// 2^12 words of 64 bits, 2^18 voxels per page
+#define OCCUPANCYBITMAP_PAGE_BITS 12
+
+// One bit per voxel id, set for occupied voxels. Bits are kept in 32 KB pages that are allocated on the first
+// voxel set in them, so grids with only a surface occupied don't pay for the empty space around it.
+class OccupancyBitmap {
+public:
+    OccupancyBitmap() {}
+    OccupancyBitmap(uint64_t num_voxels);
+
+    bool test(uint64_t voxel_id) const;
+    void set(uint64_t voxel_id);
+    void reset(uint64_t voxel_id);
+
+    // Number of set bits, using the CPU's popcount instruction where available
+    uint64_t count() const;
+
+    // Calls func(voxel_id) for every set bit in increasing voxel id order, skipping empty pages and words
+    template <typename Func>
+    void forEachSet(Func func) const;
+
+    // forEachSet restricted to the voxel ids in [begin, end)
+    template <typename Func>
+    void forEachSet(uint64_t begin, uint64_t end, Func func) const;
+
+private:
+    static const uint64_t PAGE_WORDS = (uint64_t) 1 << OCCUPANCYBITMAP_PAGE_BITS;
+
+    static uint64_t countScalar(const uint64_t *words, uint64_t num_words);
+    static uint64_t countPOPCNT(const uint64_t *words, uint64_t num_words);
+
+    std::vector<std::unique_ptr<uint64_t[]>> _pages;
+
+};
+
+inline bool OccupancyBitmap::test(uint64_t voxel_id) const {
+
+    const uint64_t *page = _pages[voxel_id >> (OCCUPANCYBITMAP_PAGE_BITS + 6)].get();
+    if (page == nullptr)
+        return false;
+
+    return (page[(voxel_id >> 6) & (PAGE_WORDS - 1)] >> (voxel_id & 63)) & 1;
+}
+
+inline void OccupancyBitmap::set(uint64_t voxel_id) {
+
+    std::unique_ptr<uint64_t[]> &page = _pages[voxel_id >> (OCCUPANCYBITMAP_PAGE_BITS + 6)];
+    if (!page)
+        page.reset(new uint64_t[PAGE_WORDS]());
+
+    page[(voxel_id >> 6) & (PAGE_WORDS - 1)] |= (uint64_t) 1 << (voxel_id & 63);
+}
+
+inline void OccupancyBitmap::reset(uint64_t voxel_id) {
+
+    uint64_t *page = _pages[voxel_id >> (OCCUPANCYBITMAP_PAGE_BITS + 6)].get();
+    if (page != nullptr)
+        page[(voxel_id >> 6) & (PAGE_WORDS - 1)] &= ~((uint64_t) 1 << (voxel_id & 63));
+}
+
+template <typename Func>
+void OccupancyBitmap::forEachSet(Func func) const {
+
+    for (uint64_t page_i = 0; page_i < _pages.size(); page_i++) {
+
+        const uint64_t *page = _pages[page_i].get();
+        if (page == nullptr)
+            continue;
+
+        for (uint64_t word_i = 0; word_i < PAGE_WORDS; word_i++) {
+
+            uint64_t word = page[word_i];
+            uint64_t word_begin = ((page_i << OCCUPANCYBITMAP_PAGE_BITS) + word_i) << 6;
+
+            while (word != 0) {
+                func(word_begin + __builtin_ctzll(word));
+                word &= word - 1;
+            }
+        }
+    }
+}
+
+template <typename Func>
+void OccupancyBitmap::forEachSet(uint64_t begin, uint64_t end, Func func) const {
+
+    uint64_t word_end = std::min<uint64_t>((end + 63) >> 6, (uint64_t) _pages.size() << OCCUPANCYBITMAP_PAGE_BITS);
+
+    for (uint64_t word_i = begin >> 6; word_i < word_end; word_i++) {
+
+        const uint64_t *page = _pages[word_i >> OCCUPANCYBITMAP_PAGE_BITS].get();
+        if (page == nullptr) {
+            word_i |= PAGE_WORDS - 1;
+            continue;
+        }
+
+        uint64_t word = page[word_i & (PAGE_WORDS - 1)];
+        uint64_t word_begin = word_i << 6;
+
+        if (word_begin < begin)
+            word &= ~(uint64_t) 0 << (begin - word_begin);
+        if (end - word_begin < 64)
+            word &= ((uint64_t) 1 << (end - word_begin)) - 1;
+
+        while (word != 0) {
+            func(word_begin + __builtin_ctzll(word));
+            word &= word - 1;
+        }
+    }
+}
+
+#endif /* defined(__OCCUPANCYBITMAP__) */
@@ -0,0 +1,61 @@
+/*
+ Classy Voxelizer
+
+ BSD 2-Clause License
+ Copyright (c) 2018, Dario Rethage
+ See LICENSE at package root for full license
+ */
+
+#ifndef __PLYSTREAMWRITER__
+#define __PLYSTREAMWRITER__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <fstream>
+
+#define PLYSTREAMWRITER_BUFFER_SIZE (1 << 20)
+
+// Writes a binary little-endian PLY file with a single element, one record at a time, through a fixed-size buffer.
+// The header carries the number of records, so it has to be known up front; properties are given as "<type> <name>".
+// Values are written in host byte order, like tinyply does.
+class PLYStreamWriter {
+public:
+    PLYStreamWriter(const std::string &filepath, const std::string &element_name, uint64_t num_records, const std::vector<std::string> &properties);
+    ~PLYStreamWriter();
+
+    template <typename T>
+    void write(const T &value);
+
+    // Flushes the buffer and closes the file, throws if anything failed to write
+    void close();
+
+    // Writes the records of PLY files written by PLYStreamWriter with the same element and properties, in order,
+    // into a single file. Throws if an input can't be read or doesn't match the first one.
+    static void concatenate(const std::vector<std::string> &input_filepaths, const std::string &filepath);
+
+private:
+    void flush();
+
+    std::ofstream _file;
+    std::unique_ptr<char[]> _buffer;
+    size_t _buffer_used;
+    std::string _filepath;
+
+};
+
+template <typename T>
+inline void PLYStreamWriter::write(const T &value) {
+
+    if (_buffer_used + sizeof(T) > PLYSTREAMWRITER_BUFFER_SIZE)
+        flush();
+
+    memcpy(_buffer.get() + _buffer_used, &value, sizeof(T));
+    _buffer_used += sizeof(T);
+}
+
+#endif /* defined(__PLYSTREAMWRITER__) */
@@ -0,0 +1,93 @@
+/*
+ Classy Voxelizer
+
+ BSD 2-Clause License
+ Copyright (c) 2018, Dario Rethage
+ See LICENSE at package root for full license
+ */
+
+#ifndef __PARTIALVOXELGRID__
+#define __PARTIALVOXELGRID__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <utility>
+
+//Eigen
+#include <Eigen/Dense>
+
+#define PARTIALVOXELGRID_VERSION 1
+// Voxels buffered per read or write of a partial grid file
+#define PARTIALVOXELGRID_CHUNK_VOXELS (1 << 16)
+
+// Partial grids hold the occupied voxels of one region of a grid, e.g. the slab of a shard, indexed like the whole
+// grid so partial grids of the same grid can be merged voxel for voxel. Files are little-endian:
+//   PartialGridHeader
+//   int32_t class_color_mapping[num_classes][3]     red, green, blue of classes 1 to num_classes
+//   (uint64_t voxel_id, payload) voxels[num_voxels]  payload_size bytes per payload, in voxel id order
+struct PartialGridHeader {
+    char magic[4];              // "CVXP"
+    uint32_t version;
+    uint32_t payload_size;
+    uint32_t num_classes;
+    float grid_min[3];
+    float grid_max[3];
+    float voxel_size;
+    int32_t region_begin[3];
+    int32_t region_end[3];
+    uint32_t padding;
+    uint64_t num_voxels;
+};
+
+// Reads a partial grid file, voxels in chunks
+class PartialVoxelGridFile {
+public:
+    // False if the file can't be read or is not a partial grid
+    bool open(const std::string &filepath);
+
+    const PartialGridHeader &getHeader() const { return _header; }
+    const std::vector<Eigen::Vector3i> &getClassColorMapping() const { return _class_color_mapping; }
+
+    // Replaces voxels with the next PARTIALVOXELGRID_CHUNK_VOXELS voxels or fewer, false once all are read or on a
+    // read error (see failed()). Payload must have the header's payload size.
+    template <typename Payload>
+    bool read(std::vector<std::pair<uint64_t, Payload>> &voxels);
+
+    bool failed() const { return _num_read < _header.num_voxels; }
+
+private:
+    std::ifstream _file;
+    PartialGridHeader _header;
+    std::vector<Eigen::Vector3i> _class_color_mapping;
+    std::vector<char> _buffer;
+    uint64_t _num_read = 0;
+};
+
+template <typename Payload>
+bool PartialVoxelGridFile::read(std::vector<std::pair<uint64_t, Payload>> &voxels) {
+
+    voxels.clear();
+
+    const size_t record_size = sizeof(uint64_t) + sizeof(Payload);
+    size_t num_voxels = std::min<uint64_t>(PARTIALVOXELGRID_CHUNK_VOXELS, _header.num_voxels - _num_read);
+
+    _buffer.resize(num_voxels * record_size);
+    if (num_voxels == 0 || sizeof(Payload) != _header.payload_size || !_file.read(_buffer.data(), _buffer.size()))
+        return false;
+
+    voxels.resize(num_voxels);
+    for (size_t i = 0; i < num_voxels; i++) {
+        memcpy(&voxels[i].first, &_buffer[i * record_size], sizeof(uint64_t));
+        memcpy(&voxels[i].second, &_buffer[i * record_size + sizeof(uint64_t)], sizeof(Payload));
+    }
+
+    _num_read += num_voxels;
+    return true;
+}
+
+#endif /* defined(__PARTIALVOXELGRID__) */
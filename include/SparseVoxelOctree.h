@@ -0,0 +1,290 @@
+/*
+ Classy Voxelizer
+
+ BSD 2-Clause License
+ Copyright (c) 2018, Dario Rethage
+ See LICENSE at package root for full license
+ */
+
+#ifndef __SPARSEVOXELOCTREE__
+#define __SPARSEVOXELOCTREE__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <thread>
+#include <stdexcept>
+#include <algorithm>
+
+//Eigen
+#include <Eigen/Dense>
+
+#include "VoxelPayload.h"
+#include "WorkStealingScheduler.h"
+#include "Stats.h"
+
+#define SPARSEVOXELOCTREE_VERSION 1
+#define SPARSEVOXELOCTREE_MIN_NODES_PER_THREAD (1 << 14)
+
+// Octree files are little-endian and 8-byte aligned throughout, so they can be mapped and read in place:
+//   SVOHeader
+//   uint64_t level_begins[num_levels + 1]   node index range of every level, level 0 is the root
+//   SVONode nodes[num_nodes]                breadth-first, every level in Morton order
+//   payloads[num_nodes]                     payload_size bytes per node, padded to 8 bytes at the end
+// Leaves, at level num_levels - 1, are the occupied voxels of the grid. Inner nodes hold VoxelPayloadTraits::reduce
+// of their children, so every level is a coarser version of the grid, like the levels of VoxelGrid::downsample.
+struct SVOHeader {
+    char magic[4];              // "CSVO"
+    uint32_t version;
+    uint32_t payload_size;
+    uint32_t num_levels;
+    float origin[3];            // corner of the grid
+    float voxel_size;           // of the leaves, every level up doubles it
+    uint64_t num_nodes;
+};
+
+struct SVONode {
+    uint32_t first_child;       // index of the first child; the children follow it in octant order
+    uint8_t child_mask;         // bit x + 2y + 4z set if that octant has a child, 0 for leaves
+    uint8_t padding[3];
+};
+
+// Interleaves the bits of the voxel coordinates, x lowest. Coordinates take at most 21 bits.
+inline uint64_t encodeMorton(uint32_t i, uint32_t j, uint32_t k) {
+
+    auto spread = [](uint64_t x) {
+        x &= 0x1fffff;
+        x = (x | (x << 32)) & 0x1f00000000ffffull;
+        x = (x | (x << 16)) & 0x1f0000ff0000ffull;
+        x = (x | (x << 8)) & 0x100f00f00f00f00full;
+        x = (x | (x << 4)) & 0x10c30c30c30c30c3ull;
+        x = (x | (x << 2)) & 0x1249249249249249ull;
+        return x;
+    };
+
+    return spread(i) | (spread(j) << 1) | (spread(k) << 2);
+}
+
+// Builds an octree bottom-up from the occupied voxels of a grid and writes it in the format above
+template <typename Payload>
+class SparseVoxelOctree {
+public:
+    typedef VoxelPayloadTraits<Payload> Traits;
+
+    // leaves are (Morton code, payload) pairs sorted by code, with num_levels - 1 bits per coordinate
+    SparseVoxelOctree(const std::vector<std::pair<uint64_t, Payload>> &leaves, uint32_t num_levels, unsigned int num_threads);
+
+    uint64_t getNumNodes() const;
+
+    // Throws std::runtime_error if the file can't be written or the octree has more nodes than first_child can index
+    void save(const std::string &filepath, Eigen::Vector3f origin, float voxel_size) const;
+
+private:
+    struct Level {
+        std::vector<uint64_t> codes;
+        std::vector<uint8_t> child_masks;
+        std::vector<Payload> payloads;
+    };
+
+    void reduceLevel(const Level &children, Level &parents, size_t begin, size_t end) const;
+
+    std::vector<Level> _levels;
+
+};
+
+// Every level is reduced from the one below it on up to num_threads threads. Threads take contiguous runs of children,
+// cut where the parent changes, so every thread reduces whole subtrees and their parents come out in Morton order.
+template <typename Payload>
+SparseVoxelOctree<Payload>::SparseVoxelOctree(const std::vector<std::pair<uint64_t, Payload>> &leaves, uint32_t num_levels, unsigned int num_threads) {
+
+    _levels.resize(std::max<uint32_t>(num_levels, 1));
+
+    Level &leaf_level = _levels.back();
+    leaf_level.codes.reserve(leaves.size());
+    leaf_level.payloads.reserve(leaves.size());
+    for (const auto &leaf : leaves) {
+        leaf_level.codes.push_back(leaf.first);
+        leaf_level.payloads.push_back(leaf.second);
+    }
+    leaf_level.child_masks.assign(leaves.size(), 0);
+
+    for (size_t level = _levels.size() - 1; level > 0; level--) {
+
+        const Level &children = _levels[level];
+        size_t num_children = children.codes.size();
+        size_t num_chunks = std::max<size_t>(1, std::min<size_t>(resolveNumThreads(num_threads), num_children / SPARSEVOXELOCTREE_MIN_NODES_PER_THREAD));
+
+        std::vector<size_t> bounds(num_chunks + 1, num_children);
+        bounds[0] = 0;
+        for (size_t chunk_i = 1; chunk_i < num_chunks; chunk_i++) {
+            size_t bound = std::max(bounds[chunk_i - 1], num_children * chunk_i / num_chunks);
+            while (bound > 0 && bound < num_children && (children.codes[bound] >> 3) == (children.codes[bound - 1] >> 3))
+                bound++;
+            bounds[chunk_i] = bound;
+        }
+
+        std::vector<Level> chunks(num_chunks);
+        std::vector<std::thread> threads;
+        for (size_t chunk_i = 1; chunk_i < num_chunks; chunk_i++)
+            threads.emplace_back([&, chunk_i]() { reduceLevel(children, chunks[chunk_i], bounds[chunk_i], bounds[chunk_i + 1]); });
+        reduceLevel(children, chunks[0], bounds[0], bounds[1]);
+        for (auto &thread : threads)
+            thread.join();
+
+        Level &parents = _levels[level - 1];
+        for (const Level &chunk : chunks) {
+            parents.codes.insert(parents.codes.end(), chunk.codes.begin(), chunk.codes.end());
+            parents.child_masks.insert(parents.child_masks.end(), chunk.child_masks.begin(), chunk.child_masks.end());
+            parents.payloads.insert(parents.payloads.end(), chunk.payloads.begin(), chunk.payloads.end());
+        }
+    }
+}
+
+template <typename Payload>
+void SparseVoxelOctree<Payload>::reduceLevel(const Level &children, Level &parents, size_t begin, size_t end) const {
+
+    Payload siblings[8];
+
+    for (size_t first = begin; first < end; ) {
+
+        uint64_t parent_code = children.codes[first] >> 3;
+        uint8_t child_mask = 0;
+        int num_siblings = 0;
+
+        for (size_t i = first; i < end && (children.codes[i] >> 3) == parent_code; i++) {
+            child_mask |= 1 << (children.codes[i] & 7);
+            siblings[num_siblings++] = children.payloads[i];
+        }
+
+        parents.codes.push_back(parent_code);
+        parents.child_masks.push_back(child_mask);
+        parents.payloads.push_back(Traits::reduce(siblings, num_siblings));
+        first += num_siblings;
+    }
+}
+
+template <typename Payload>
+uint64_t SparseVoxelOctree<Payload>::getNumNodes() const {
+
+    uint64_t num_nodes = 0;
+    for (const Level &level : _levels)
+        num_nodes += level.codes.size();
+
+    return num_nodes;
+}
+
+template <typename Payload>
+void SparseVoxelOctree<Payload>::save(const std::string &filepath, Eigen::Vector3f origin, float voxel_size) const {
+
+    // SVONode::first_child indexes nodes in 32 bits
+    if (getNumNodes() > UINT32_MAX)
+        throw std::runtime_error("SparseVoxelOctree: too many nodes for the octree format");
+
+    std::ofstream output_file(filepath, std::ios::binary);
+    if (!output_file)
+        throw std::runtime_error("SparseVoxelOctree: could not open " + filepath);
+
+    SVOHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "CSVO", 4);
+    header.version = SPARSEVOXELOCTREE_VERSION;
+    header.payload_size = sizeof(Payload);
+    header.num_levels = _levels.size();
+    for (int i = 0; i < 3; i++)
+        header.origin[i] = origin[i];
+    header.voxel_size = voxel_size;
+    header.num_nodes = getNumNodes();
+    output_file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    std::vector<uint64_t> level_begins(1, 0);
+    for (const Level &level : _levels)
+        level_begins.push_back(level_begins.back() + level.codes.size());
+    output_file.write(reinterpret_cast<const char *>(level_begins.data()), level_begins.size() * sizeof(uint64_t));
+
+    // children are numbered in the order of their parents, so first_child is a running count of the mask bits
+    std::vector<SVONode> nodes;
+    for (size_t level = 0; level < _levels.size(); level++) {
+
+        uint64_t first_child = level_begins[level + 1];
+        nodes.assign(_levels[level].codes.size(), SVONode());
+
+        for (size_t node_i = 0; node_i < nodes.size(); node_i++) {
+            uint8_t child_mask = _levels[level].child_masks[node_i];
+            nodes[node_i].first_child = (child_mask != 0) ? first_child : 0;
+            nodes[node_i].child_mask = child_mask;
+            first_child += __builtin_popcount(child_mask);
+        }
+
+        output_file.write(reinterpret_cast<const char *>(nodes.data()), nodes.size() * sizeof(SVONode));
+    }
+
+    for (const Level &level : _levels)
+        output_file.write(reinterpret_cast<const char *>(level.payloads.data()), level.payloads.size() * sizeof(Payload));
+
+    const char padding[8] = {0};
+    output_file.write(padding, (8 - (header.num_nodes * sizeof(Payload)) % 8) % 8);
+    STATS_ADD(BYTES_WRITTEN, output_file.tellp());
+
+    output_file.close();
+    if (!output_file)
+        throw std::runtime_error("SparseVoxelOctree: could not write " + filepath);
+}
+
+// Reads an octree file in place: the file is memory-mapped where the platform allows it, read into memory otherwise,
+// and nodes and payloads are accessed straight from the file's bytes without a parsing step
+class SparseVoxelOctreeFile {
+public:
+    SparseVoxelOctreeFile() {}
+    ~SparseVoxelOctreeFile();
+
+    // Maps the file and checks its header and size, false if it is not a valid octree file
+    bool open(const std::string &filepath);
+    void close();
+
+    uint32_t getNumLevels() const { return _header->num_levels; }
+    uint64_t getNumNodes() const { return _header->num_nodes; }
+    uint32_t getPayloadSize() const { return _header->payload_size; }
+
+    // Nodes of level are [getLevelBegin(level), getLevelEnd(level)), level 0 is the root
+    uint64_t getLevelBegin(uint32_t level) const { return _level_begins[level]; }
+    uint64_t getLevelEnd(uint32_t level) const { return _level_begins[level + 1]; }
+
+    Eigen::Vector3f getOrigin() const { return Eigen::Vector3f(_header->origin[0], _header->origin[1], _header->origin[2]); }
+    float getVoxelSize(uint32_t level) const { return _header->voxel_size * (float) ((uint64_t) 1 << (_header->num_levels - 1 - level)); }
+
+    uint8_t getChildMask(uint64_t node) const { return _nodes[node].child_mask; }
+
+    // The child of node in octant x + 2y + 4z, -1 if there is none
+    int64_t getChild(uint64_t node, int octant) const;
+
+    // The node holding voxel (i, j, k) of level, -1 if that voxel is empty
+    int64_t findNode(uint32_t level, uint32_t i, uint32_t j, uint32_t k) const;
+
+    const uint8_t *getPayload(uint64_t node) const { return _payloads + node * _header->payload_size; }
+
+    // The payload of node as a Payload, which must be the type the octree was saved with
+    template <typename Payload>
+    Payload getPayloadAs(uint64_t node) const {
+        Payload payload;
+        memcpy(&payload, getPayload(node), sizeof(Payload));
+        return payload;
+    }
+
+private:
+    SparseVoxelOctreeFile(const SparseVoxelOctreeFile &) = delete;
+    SparseVoxelOctreeFile &operator=(const SparseVoxelOctreeFile &) = delete;
+
+    void *_mapping = nullptr;
+    size_t _mapping_size = 0;
+    std::vector<uint64_t> _buffer;
+    const SVOHeader *_header = nullptr;
+    const uint64_t *_level_begins = nullptr;
+    const SVONode *_nodes = nullptr;
+    const uint8_t *_payloads = nullptr;
+};
+
+#endif /* defined(__SPARSEVOXELOCTREE__) */
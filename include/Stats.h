@@ -0,0 +1,98 @@
+/*
+ Classy Voxelizer
+
+ BSD 2-Clause License
+ Copyright (c) 2018, Dario Rethage
+ See LICENSE at package root for full license
+ */
+
+#ifndef __STATS__
+#define __STATS__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string>
+#include <chrono>
+
+// Run statistics for --stats: seconds spent per phase and counters of what the voxelizers did.
+// The STATS_* macros record them and compile to nothing unless CLASSYVOXELIZER_STATS is defined (the
+// CLASSYVOXELIZER_STATS CMake option); when compiled in, they cost one branch until Stats::enable() is called.
+// Counters go to blocks of the calling thread, so recording takes no lock; blocks are summed by save().
+class Stats {
+public:
+    enum Counter {
+        FACES,                  // faces handed to a voxelizer
+        SUB_FACES,              // sub-faces split off by splitFace, two per split
+        MIDPOINTS,              // midpoints added by splitFace, one per split
+        MAX_SPLIT_DEPTH,        // deepest splitFace stack, the depth VOXELIZER_MAX_SPLIT_DEPTH bounds (a maximum)
+        VOXEL_WRITES,           // payloads the voxelizers hand to their reducer
+        VOXELS_SET,             // payloads set in grids, by reducers, downsampling and merges
+        VOXELS_OVERWRITTEN,     // of those, the ones set in voxels that were already occupied
+        OCCUPIED_VOXELS,        // occupied voxels of the voxelized or merged grids
+        BYTES_WRITTEN,          // bytes of PLY, octree and partial grid files written
+        NUM_COUNTERS
+    };
+
+    // Starts recording; the run's wall time counts from here
+    static void enable();
+    static bool isEnabled() { return _enabled; }
+
+    static void add(Counter counter, uint64_t n) { getThreadCounters()[counter] += n; }
+    static void max(Counter counter, uint64_t n) {
+        uint64_t &value = getThreadCounters()[counter];
+        if (n > value)
+            value = n;
+    }
+
+    static void addPhaseSeconds(const char *phase, double seconds);
+
+    // Writes the phases and counters as JSON once all recording threads are done; throws if the file can't be written
+    static void save(const std::string &filepath);
+
+    // Adds its lifetime to a phase, if recording
+    class PhaseTimer {
+    public:
+        explicit PhaseTimer(const char *phase) : _phase(isEnabled() ? phase : nullptr) {
+            if (_phase)
+                _start = std::chrono::steady_clock::now();
+        }
+        ~PhaseTimer() {
+            if (_phase)
+                addPhaseSeconds(_phase, std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count());
+        }
+
+    private:
+        const char *_phase;
+        std::chrono::steady_clock::time_point _start;
+    };
+
+private:
+    static uint64_t *getThreadCounters() {
+        if (_thread_counters == nullptr)
+            _thread_counters = registerThread();
+        return _thread_counters;
+    }
+
+    static uint64_t *registerThread();
+
+    static bool _enabled;
+    // Constant-initialized, so access needs no per-thread initialization check
+    static thread_local uint64_t *_thread_counters;
+};
+
+#ifdef CLASSYVOXELIZER_STATS
+#define STATS_ADD(counter, n) do { if (Stats::isEnabled()) Stats::add(Stats::counter, (n)); } while (0)
+#define STATS_MAX(counter, n) do { if (Stats::isEnabled()) Stats::max(Stats::counter, (n)); } while (0)
+#define STATS_PHASE_NAME(line) stats_phase_##line
+#define STATS_PHASE_AT(phase, line) Stats::PhaseTimer STATS_PHASE_NAME(line)(phase)
+#define STATS_PHASE_AT_LINE(phase, line) STATS_PHASE_AT(phase, line)
+// Times the rest of the enclosing scope as phase
+#define STATS_PHASE(phase) STATS_PHASE_AT_LINE(phase, __LINE__)
+#else
+#define STATS_ADD(counter, n) do { (void) sizeof(n); } while (0)
+#define STATS_MAX(counter, n) do { (void) sizeof(n); } while (0)
+#define STATS_PHASE(phase) do {} while (0)
+#endif
+
+#endif /* defined(__STATS__) */
@@ -0,0 +1,267 @@
+/*
+ Classy Voxelizer
+
+ BSD 2-Clause License
+ Copyright (c) 2018, Dario Rethage
+ See LICENSE at package root for full license
+ */
+
+#ifndef __TILEDVOXELIZER__
+#define __TILEDVOXELIZER__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include <map>
+#include <string>
+#include <fstream>
+#include <stdexcept>
+#include <algorithm>
+
+//Eigen
+#include <Eigen/Dense>
+
+#include "Voxelizer.h"
+
+// Faces buffered in memory across all tiles before they are appended to the tiles' files
+#define TILEDVOXELIZER_BUFFERED_BYTES (64 << 20)
+
+// Faces read from a mesh file for every binFaces() call when they are streamed
+#define TILEDVOXELIZER_FACES_PER_CHUNK (1 << 20)
+
+// Voxelizes a mesh tile by tile, so memory is bounded by the faces and voxels of one tile instead of the whole grid.
+// binFaces() streams faces into one file per cubic tile of tile_size voxels, a face going to every tile its voxels may
+// reach. voxelizeTile() then voxelizes a tile's faces, in mesh order, into a sparse grid restricted to the tile but
+// indexed like the whole grid, so every voxel sees the same faces and gets the same payload as in a single pass.
+// Sub-faces outside the tile are not split any further, so a face crossing many tiles is not split whole in each.
+template <typename Payload, typename Reducer>
+class TiledVoxelizer {
+public:
+    typedef SparseVoxelStorage<Payload> Storage;
+    typedef VoxelGrid<Payload, Storage> Grid;
+
+    // Tile files are named <bin_filepath>.tile<i>_<j>_<k>
+    TiledVoxelizer(Eigen::Vector3f grid_min, Eigen::Vector3f grid_max, float voxel_size, int tile_size, const std::string &bin_filepath);
+    ~TiledVoxelizer();
+
+    // May be called repeatedly with consecutive chunks of a mesh's faces, which index into all of its vertices
+    void binFaces(const std::vector<Eigen::Vector3f> &vertices, const std::vector<uint32_t> &faces, const std::vector<Payload> &vertex_payloads);
+
+    // Tiles holding faces, or every tile of the grid, in voxel id order of their first voxel
+    std::vector<Eigen::Vector3i> getTiles(bool include_empty);
+
+    VoxelBox getTileBox(const Eigen::Vector3i &tile);
+
+    // Voxelizes the faces of a tile, if any, and removes its file
+    Grid voxelizeTile(const Eigen::Vector3i &tile, bool overlap_engine, TriangleVoxelCoverage::Separability separability, unsigned int num_threads);
+
+private:
+    struct FaceRecord {
+        Eigen::Vector3f vertices[3];
+        Payload payloads[3];
+    };
+
+    uint64_t getTileKey(const Eigen::Vector3i &tile);
+    Eigen::Vector3i getTile(uint64_t tile_key);
+    std::string getTileFilepath(uint64_t tile_key);
+    void flush();
+
+    Eigen::Vector3f _grid_min;
+    Eigen::Vector3f _grid_max;
+    float _voxel_size;
+    int _tile_size;
+    std::string _bin_filepath;
+    Eigen::Vector3i _voxels_per_dim;
+    Eigen::Vector3i _tiles_per_dim;
+    VoxelIndexer _indexer;
+    std::map<uint64_t, std::vector<FaceRecord>> _buffers;
+    std::map<uint64_t, uint64_t> _num_binned;
+    size_t _num_buffered;
+};
+
+template <typename Payload, typename Reducer>
+TiledVoxelizer<Payload, Reducer>::TiledVoxelizer(Eigen::Vector3f grid_min, Eigen::Vector3f grid_max, float voxel_size, int tile_size, const std::string &bin_filepath) {
+
+    _grid_min = grid_min;
+    _grid_max = grid_max;
+    _voxel_size = voxel_size;
+    _tile_size = std::max(tile_size, 1);
+    _bin_filepath = bin_filepath;
+    _voxels_per_dim = ((grid_max - grid_min) / voxel_size).cast<int>();
+    _tiles_per_dim = (_voxels_per_dim.array() + _tile_size - 1) / _tile_size;
+    _indexer = VoxelIndexer(grid_min, grid_max, voxel_size, _voxels_per_dim);
+    _num_buffered = 0;
+
+}
+
+// Tile files left behind by an exception are removed
+template <typename Payload, typename Reducer>
+TiledVoxelizer<Payload, Reducer>::~TiledVoxelizer() {
+
+    for (const auto &tile : _num_binned)
+        remove(getTileFilepath(tile.first).c_str());
+}
+
+template <typename Payload, typename Reducer>
+uint64_t TiledVoxelizer<Payload, Reducer>::getTileKey(const Eigen::Vector3i &tile) {
+    return ((uint64_t) tile[2] * _tiles_per_dim[1] + tile[1]) * _tiles_per_dim[0] + tile[0];
+}
+
+template <typename Payload, typename Reducer>
+Eigen::Vector3i TiledVoxelizer<Payload, Reducer>::getTile(uint64_t tile_key) {
+    uint64_t tiles_per_slice = (uint64_t) _tiles_per_dim[0] * _tiles_per_dim[1];
+    return Eigen::Vector3i(tile_key % _tiles_per_dim[0], (tile_key % tiles_per_slice) / _tiles_per_dim[0], tile_key / tiles_per_slice);
+}
+
+template <typename Payload, typename Reducer>
+std::string TiledVoxelizer<Payload, Reducer>::getTileFilepath(uint64_t tile_key) {
+    Eigen::Vector3i tile = getTile(tile_key);
+    return _bin_filepath + ".tile" + std::to_string(tile[0]) + "_" + std::to_string(tile[1]) + "_" + std::to_string(tile[2]);
+}
+
+template <typename Payload, typename Reducer>
+VoxelBox TiledVoxelizer<Payload, Reducer>::getTileBox(const Eigen::Vector3i &tile) {
+    return VoxelBox(tile * _tile_size, ((tile.array() + 1) * _tile_size).matrix().cwiseMin(_voxels_per_dim));
+}
+
+// A face reaches at most the voxels between the ones enclosing its corners, one more on each side covers
+// the overlap tests of faces lying on voxel borders. Faces outside the grid are dropped.
+template <typename Payload, typename Reducer>
+void TiledVoxelizer<Payload, Reducer>::binFaces(const std::vector<Eigen::Vector3f> &vertices, const std::vector<uint32_t> &faces, const std::vector<Payload> &vertex_payloads) {
+
+    STATS_PHASE("bin_faces");
+    TRACE_SPAN("bin_faces");
+
+    // only the corners of the chunk are looked up, not all vertices of the mesh
+    std::vector<Eigen::Vector3f> corners(faces.size());
+    for (size_t i = 0; i < faces.size(); i++)
+        corners[i] = vertices[faces[i]];
+
+    std::vector<int64_t> corner_voxel_ids(corners.size());
+    _indexer.getEnclosingVoxelIDs(corners.data(), corners.size(), corner_voxel_ids.data());
+
+    uint64_t voxels_per_slice = (uint64_t) _voxels_per_dim[0] * _voxels_per_dim[1];
+
+    for (size_t i = 0; i + 2 < faces.size(); i += 3) {
+
+        FaceRecord record;
+        Eigen::Vector3i voxel_min = _voxels_per_dim;
+        Eigen::Vector3i voxel_max(-1, -1, -1);
+
+        for (int j = 0; j < 3; j++) {
+            record.vertices[j] = corners[i + j];
+            record.payloads[j] = vertex_payloads[faces[i + j]];
+        }
+
+        for (int j = 0; j < 3; j++) {
+
+            int64_t voxel_id = corner_voxel_ids[i + j];
+            if (voxel_id < 0)
+                continue;
+
+            uint64_t slice_offset = voxel_id % voxels_per_slice;
+            Eigen::Vector3i voxel(slice_offset % _voxels_per_dim[0], slice_offset / _voxels_per_dim[0], voxel_id / voxels_per_slice);
+            voxel_min = voxel_min.cwiseMin(voxel);
+            voxel_max = voxel_max.cwiseMax(voxel);
+        }
+
+        if ((voxel_max.array() < 0).any())
+            continue;
+
+        Eigen::Vector3i tile_min = ((voxel_min.array() - 1).max(0) / _tile_size).matrix();
+        Eigen::Vector3i tile_max = ((voxel_max.array() + 1).min(_voxels_per_dim.array() - 1) / _tile_size).matrix();
+
+        for (int tile_k = tile_min[2]; tile_k <= tile_max[2]; tile_k++) {
+            for (int tile_j = tile_min[1]; tile_j <= tile_max[1]; tile_j++) {
+                for (int tile_i = tile_min[0]; tile_i <= tile_max[0]; tile_i++) {
+                    _buffers[getTileKey(Eigen::Vector3i(tile_i, tile_j, tile_k))].push_back(record);
+                    _num_buffered++;
+                }
+            }
+        }
+
+        if (_num_buffered * sizeof(FaceRecord) >= TILEDVOXELIZER_BUFFERED_BYTES)
+            flush();
+    }
+}
+
+template <typename Payload, typename Reducer>
+void TiledVoxelizer<Payload, Reducer>::flush() {
+
+    for (auto &buffer : _buffers) {
+
+        if (buffer.second.empty())
+            continue;
+
+        // the first flush of a tile replaces any file left over from an earlier run
+        std::ios::openmode mode = _num_binned.count(buffer.first) ? std::ios::app : std::ios::trunc;
+        std::ofstream tile_file(getTileFilepath(buffer.first), std::ios::binary | std::ios::out | mode);
+        tile_file.write(reinterpret_cast<const char *>(buffer.second.data()), buffer.second.size() * sizeof(FaceRecord));
+        tile_file.close();
+
+        if (!tile_file)
+            throw std::runtime_error("TiledVoxelizer: could not write " + getTileFilepath(buffer.first));
+
+        _num_binned[buffer.first] += buffer.second.size();
+    }
+
+    _buffers.clear();
+    _num_buffered = 0;
+}
+
+template <typename Payload, typename Reducer>
+std::vector<Eigen::Vector3i> TiledVoxelizer<Payload, Reducer>::getTiles(bool include_empty) {
+
+    std::vector<Eigen::Vector3i> tiles;
+    flush();
+
+    if (include_empty) {
+        for (uint64_t tile_key = 0; tile_key < (uint64_t) _tiles_per_dim.cast<int64_t>().prod(); tile_key++)
+            tiles.push_back(getTile(tile_key));
+    } else {
+        for (const auto &tile : _num_binned)
+            tiles.push_back(getTile(tile.first));
+    }
+
+    return tiles;
+}
+
+template <typename Payload, typename Reducer>
+typename TiledVoxelizer<Payload, Reducer>::Grid TiledVoxelizer<Payload, Reducer>::voxelizeTile(const Eigen::Vector3i &tile, bool overlap_engine, TriangleVoxelCoverage::Separability separability, unsigned int num_threads) {
+
+    flush();
+
+    uint64_t tile_key = getTileKey(tile);
+    uint64_t num_faces = _num_binned.count(tile_key) ? _num_binned[tile_key] : 0;
+    TRACE_SPAN_DETAIL("tile", getTileFilepath(tile_key));
+
+    std::vector<FaceRecord> records(num_faces);
+    std::ifstream tile_file(getTileFilepath(tile_key), std::ios::binary);
+    if (num_faces > 0 && !tile_file.read(reinterpret_cast<char *>(records.data()), num_faces * sizeof(FaceRecord)))
+        throw std::runtime_error("TiledVoxelizer: could not read " + getTileFilepath(tile_key));
+    tile_file.close();
+
+    remove(getTileFilepath(tile_key).c_str());
+    _num_binned.erase(tile_key);
+
+    // faces don't share corners across records, every corner gets its own vertex
+    std::vector<Eigen::Vector3f> vertices(3 * num_faces);
+    std::vector<uint32_t> faces(3 * num_faces);
+    std::vector<Payload> vertex_payloads(3 * num_faces);
+
+    for (uint64_t i = 0; i < 3 * num_faces; i++) {
+        vertices[i] = records[i / 3].vertices[i % 3];
+        vertex_payloads[i] = records[i / 3].payloads[i % 3];
+        faces[i] = i;
+    }
+    std::vector<FaceRecord>().swap(records);
+
+    if (overlap_engine)
+        return Voxelizer<Payload, Reducer, Storage>::voxelizeOverlap(vertices, faces, vertex_payloads, _grid_min, _grid_max, _voxel_size, separability, num_threads, getTileBox(tile));
+
+    return Voxelizer<Payload, Reducer, Storage>::voxelize(vertices, faces, vertex_payloads, _grid_min, _grid_max, _voxel_size, num_threads, getTileBox(tile));
+}
+
+#endif /* defined(__TILEDVOXELIZER__) */
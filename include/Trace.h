@@ -0,0 +1,83 @@
+/*
+ Classy Voxelizer
+
+ BSD 2-Clause License
+ Copyright (c) 2018, Dario Rethage
+ See LICENSE at package root for full license
+ */
+
+#ifndef __TRACE__
+#define __TRACE__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string>
+
+// Events a thread keeps; once its ring is full, a thread overwrites its oldest events. A power of two.
+#define TRACE_EVENTS_PER_THREAD (1 << 16)
+
+// Span tracing for --trace: every thread records the spans it runs into a ring of its own, without locking, and save()
+// writes them as Chrome trace events, to be loaded in Perfetto or chrome://tracing.
+// Rings are leased to threads and returned when the threads exit, so the many short-lived threads of the schedulers
+// share as many rings as ever ran at once; every ring is one lane ("tid") of the trace, named after its threads.
+// The TRACE_* macros compile to nothing unless CLASSYVOXELIZER_TRACE is defined (the CLASSYVOXELIZER_TRACE CMake
+// option); when compiled in, they cost one branch until Trace::enable() is called.
+class Trace {
+public:
+    // Starts recording; event times count from here
+    static void enable();
+    static bool isEnabled() { return _enabled; }
+
+    // Adds name to the names of the calling thread's lane
+    static void nameThread(const char *name);
+
+    // A copy of detail that lives until the trace is saved, for span details built at run time
+    static const char *intern(const std::string &detail);
+
+    // Writes the events as Chrome trace JSON once all recording threads are done; throws if the file can't be written
+    static void save(const std::string &filepath);
+
+    // Records its lifetime as a span named name, with an optional detail such as a file name. Does nothing for a null
+    // name or when not recording.
+    class Span {
+    public:
+        explicit Span(const char *name, const char *detail = nullptr) : _name(isEnabled() ? name : nullptr), _detail(detail), _begin(0) {
+            if (_name)
+                _begin = now();
+        }
+        ~Span() {
+            if (_name)
+                record(_name, _detail, _begin, now());
+        }
+
+    private:
+        const char *_name;
+        const char *_detail;
+        uint64_t _begin;
+    };
+
+private:
+    // Nanoseconds since enable()
+    static uint64_t now();
+    static void record(const char *name, const char *detail, uint64_t begin, uint64_t end);
+
+    static bool _enabled;
+};
+
+#ifdef CLASSYVOXELIZER_TRACE
+#define TRACE_SPAN_NAME(line) trace_span_##line
+#define TRACE_SPAN_AT(line, ...) Trace::Span TRACE_SPAN_NAME(line)(__VA_ARGS__)
+#define TRACE_SPAN_AT_LINE(line, ...) TRACE_SPAN_AT(line, __VA_ARGS__)
+// Traces the rest of the enclosing scope as a span
+#define TRACE_SPAN(name) TRACE_SPAN_AT_LINE(__LINE__, name)
+// Same, with a std::string detail that is only copied when recording
+#define TRACE_SPAN_DETAIL(name, detail) TRACE_SPAN_AT_LINE(__LINE__, name, Trace::isEnabled() ? Trace::intern(detail) : nullptr)
+#define TRACE_THREAD_NAME(name) do { if (Trace::isEnabled()) Trace::nameThread(name); } while (0)
+#else
+#define TRACE_SPAN(name) do {} while (0)
+#define TRACE_SPAN_DETAIL(name, detail) do {} while (0)
+#define TRACE_THREAD_NAME(name) do {} while (0)
+#endif
+
+#endif /* defined(__TRACE__) */
@@ -0,0 +1,55 @@
+/*
+ Classy Voxelizer
+
+ BSD 2-Clause License
+ Copyright (c) 2018, Dario Rethage
+ See LICENSE at package root for full license
+ */
+
+#ifndef __TRIANGLEVOXELCOVERAGE__
+#define __TRIANGLEVOXELCOVERAGE__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <math.h>
+
+//Eigen
+#include <Eigen/Dense>
+
+// Decides which voxels of a grid a triangle covers with separating-axis triangle/box tests,
+// visiting only the voxel columns along the triangle's dominant axis that its plane passes through.
+class TriangleVoxelCoverage {
+public:
+    enum Separability {
+        CONSERVATIVE,   // every voxel the triangle overlaps
+        SEPARATING_26,  // the overlapped voxels within the 26-separating distance of the triangle plane
+        SEPARATING_6    // the overlapped voxels within the 6-separating distance, the thinnest surface without 6-connected tunnels
+    };
+
+    struct CoveredVoxel {
+        uint64_t voxel_id;
+        float weights[3];   // barycentric weights of the voxel center's projection onto the triangle plane, negative ones clamped to 0 and renormalized
+    };
+
+    TriangleVoxelCoverage(Eigen::Vector3f grid_min, Eigen::Vector3i voxels_per_dim, float voxel_size, Separability separability = CONSERVATIVE);
+
+    // Appends the voxels covered by the triangle to covered, column by column.
+    // Degenerate triangles cover the voxels of their corners.
+    void cover(const Eigen::Vector3f &vertex_1, const Eigen::Vector3f &vertex_2, const Eigen::Vector3f &vertex_3, std::vector<CoveredVoxel> &covered) const;
+
+    // Index of the triangle corner with the largest weight, the lowest one on ties
+    static int getClosestCorner(const CoveredVoxel &covered_voxel);
+
+private:
+    void coverCorners(const Eigen::Vector3d vertices[3], std::vector<CoveredVoxel> &covered) const;
+    uint64_t getVoxelID(int i, int j, int k) const;
+
+    Eigen::Vector3d _grid_min;
+    Eigen::Vector3i _voxels_per_dim;
+    double _voxel_size;
+    Separability _separability;
+
+};
+
+#endif /* defined(__TRIANGLEVOXELCOVERAGE__) */
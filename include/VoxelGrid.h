@@ -0,0 +1,541 @@
+/*
+ Classy Voxelizer
+
+ BSD 2-Clause License
+ Copyright (c) 2018, Dario Rethage
+ See LICENSE at package root for full license
+ */
+
+#ifndef __VOXELGRID__
+#define __VOXELGRID__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <climits>
+#include <stdexcept>
+
+//Eigen
+#include <Eigen/Dense>
+
+#include "PLYStreamWriter.h"
+#include "VoxelIndexer.h"
+#include "VoxelPayload.h"
+#include "VoxelStorage.h"
+#include "OccupancyBitmap.h"
+#include "WorkStealingScheduler.h"
+#include "SparseVoxelOctree.h"
+#include "PartialVoxelGrid.h"
+#include "Stats.h"
+#include "Trace.h"
+
+// The voxels [begin, end) of a grid along every axis; the default box holds every voxel
+struct VoxelBox {
+    Eigen::Vector3i begin;
+    Eigen::Vector3i end;
+
+    VoxelBox() : begin(0, 0, 0), end(INT_MAX, INT_MAX, INT_MAX) {}
+    VoxelBox(Eigen::Vector3i begin, Eigen::Vector3i end) : begin(begin), end(end) {}
+
+    bool contains(int i, int j, int k) const {
+        return i >= begin[0] && j >= begin[1] && k >= begin[2] && i < end[0] && j < end[1] && k < end[2];
+    }
+};
+
+// A regular grid over [grid_min, grid_max] holding one Payload per voxel in a Storage policy (see VoxelStorage.h).
+// Voxels holding VoxelPayloadTraits<Payload>::empty() are unoccupied; an occupancy bitmap next to the storage
+// tracks the others, so counting and sparse exports never scan the payloads.
+// A grid may be restricted to a region: writes outside it are dropped and exports cover the region only, while voxel
+// ids and positions stay those of the whole grid, so grids of neighboring regions line up voxel for voxel.
+template <typename Payload, typename Storage = DenseVoxelStorage<Payload>>
+class VoxelGrid {
+public:
+    typedef VoxelPayloadTraits<Payload> Traits;
+
+    VoxelGrid(Eigen::Vector3f grid_min, Eigen::Vector3f grid_max, float voxel_size, VoxelBox region = VoxelBox());
+    int64_t getEnclosingVoxelID(Eigen::Vector3f vertex);
+    // Batched getEnclosingVoxelID, -1 for vertices outside the grid
+    void getEnclosingVoxelIDs(const Eigen::Vector3f *vertices, size_t num_vertices, int64_t *voxel_ids);
+    Eigen::Vector3i getVoxelsPerDim();
+    VoxelBox getRegion();
+    // Whether a point within the bounding box of the three vertices may have a voxel of the region, conservatively;
+    // always true for grids that are not restricted
+    bool mayReachRegion(const Eigen::Vector3f vertices[3]);
+    void setVoxel(uint64_t voxel_id, const Payload &payload);
+    Payload getVoxel(uint64_t voxel_id);
+    std::vector<Payload> getVoxelGrid();
+    void saveAsRAW(std::string filepath);
+    void saveAsPLY(std::string filepath, bool dense);
+    void saveAsPLY(std::string filepath, std::vector<Eigen::Vector3i> class_color_mapping, bool dense);
+    // Writes the payloads as a "label" vertex property instead of colors, for uint8_t payloads only
+    void saveAsPLYWithLabelProperties(std::string filepath, std::vector<Eigen::Vector3i> class_color_mapping, bool dense);
+    // Writes the occupied voxels as a sparse voxel octree (see SparseVoxelOctree.h), built on num_threads threads
+    void saveAsSVO(std::string filepath, unsigned int num_threads);
+    // Writes the occupied voxels and the region as a partial grid (see PartialVoxelGrid.h), to be merged with
+    // the partial grids of other regions by Voxelizer::mergePartials
+    void saveAsPartial(std::string filepath, std::vector<Eigen::Vector3i> class_color_mapping);
+    bool isVoxelOccupied(uint64_t voxel_id);
+    bool isVoxelOccupied(Eigen::Vector3f vertex);
+    uint64_t getNumOccupied();
+    // The grid at twice the voxel size from the same origin, every voxel reduced from its 2x2x2 children
+    // with Traits::reduce, on num_threads threads (0: all hardware threads). The region is halved, rounding outwards.
+    VoxelGrid downsample(unsigned int num_threads);
+    // Hands the voxels set and overwritten since the last call to Stats; setVoxel counts them in the grid, as going to
+    // Stats on every set would slow down the reducers
+    void recordSetStats();
+
+private:
+    uint64_t getVoxelID(int i, int j, int k);
+    bool isInRegion(uint64_t voxel_id);
+    Eigen::Vector3f getVoxelCenter(int i, int j, int k);
+    template <typename Func>
+    void forEachExportedVoxel(bool dense, Func func);
+
+    Eigen::Vector3i _voxels_per_dim;
+    Eigen::Vector3f _grid_min;
+    Eigen::Vector3f _grid_max;
+    Eigen::Vector3f _grid_size;
+    float _voxel_size;
+    uint64_t _num_voxels;
+    VoxelIndexer _indexer;
+    Storage _voxelgrid;
+    OccupancyBitmap _occupancy;
+    VoxelBox _region;
+    bool _clipped;
+    uint64_t _num_sets;
+    uint64_t _num_overwrites;
+
+};
+
+template <typename Payload, typename Storage>
+VoxelGrid<Payload, Storage>::VoxelGrid(Eigen::Vector3f grid_min, Eigen::Vector3f grid_max, float voxel_size, VoxelBox region) :
+    _voxelgrid(((grid_max - grid_min) / voxel_size).cast<int>(), Traits::empty()) {
+
+    _grid_min = grid_min;
+    _grid_max = grid_max;
+    _grid_size = grid_max - grid_min;
+    _voxel_size = voxel_size;
+    _voxels_per_dim = (_grid_size / voxel_size).cast<int>();
+    _num_voxels = _voxels_per_dim.cast<int64_t>().prod();
+    _indexer = VoxelIndexer(_grid_min, _grid_max, _voxel_size, _voxels_per_dim);
+    _occupancy = OccupancyBitmap(_num_voxels);
+    _region = VoxelBox(region.begin.cwiseMax(0), region.end.cwiseMin(_voxels_per_dim));
+    _clipped = (_region.begin != Eigen::Vector3i::Zero() || _region.end != _voxels_per_dim);
+    _num_sets = 0;
+    _num_overwrites = 0;
+
+}
+
+template <typename Payload, typename Storage>
+int64_t VoxelGrid<Payload, Storage>::getEnclosingVoxelID(Eigen::Vector3f vertex) {
+    return _indexer.getEnclosingVoxelID(vertex);
+}
+
+template <typename Payload, typename Storage>
+void VoxelGrid<Payload, Storage>::getEnclosingVoxelIDs(const Eigen::Vector3f *vertices, size_t num_vertices, int64_t *voxel_ids) {
+    _indexer.getEnclosingVoxelIDs(vertices, num_vertices, voxel_ids);
+}
+
+template <typename Payload, typename Storage>
+uint64_t VoxelGrid<Payload, Storage>::getVoxelID(int i, int j, int k) {
+    return (uint64_t) _voxels_per_dim[0] * _voxels_per_dim[1] * k + (uint64_t) _voxels_per_dim[0] * j + i;
+}
+
+template <typename Payload, typename Storage>
+bool VoxelGrid<Payload, Storage>::isInRegion(uint64_t voxel_id) {
+
+    uint64_t voxels_per_slice = (uint64_t) _voxels_per_dim[0] * _voxels_per_dim[1];
+    uint64_t slice_offset = voxel_id % voxels_per_slice;
+    return _region.contains(slice_offset % _voxels_per_dim[0], slice_offset / _voxels_per_dim[0], voxel_id / voxels_per_slice);
+}
+
+template <typename Payload, typename Storage>
+Eigen::Vector3f VoxelGrid<Payload, Storage>::getVoxelCenter(int i, int j, int k) {
+    return Eigen::Vector3f((i * _voxel_size) + _grid_min[0] + _voxel_size / 2, (j * _voxel_size) + _grid_min[1] + _voxel_size / 2, (k * _voxel_size) + _grid_min[2] + _voxel_size / 2);
+}
+
+template <typename Payload, typename Storage>
+bool VoxelGrid<Payload, Storage>::isVoxelOccupied(Eigen::Vector3f vertex) {
+
+    int64_t voxel_id = getEnclosingVoxelID(vertex);
+
+    if (voxel_id == -1)
+        return false;
+
+    return isVoxelOccupied(voxel_id);
+
+}
+
+template <typename Payload, typename Storage>
+bool VoxelGrid<Payload, Storage>::isVoxelOccupied(uint64_t voxel_id) {
+    return voxel_id < _num_voxels && _occupancy.test(voxel_id);
+}
+
+template <typename Payload, typename Storage>
+void VoxelGrid<Payload, Storage>::setVoxel(uint64_t voxel_id, const Payload &payload) {
+
+    if (voxel_id >= _num_voxels || (_clipped && !isInRegion(voxel_id)))
+        return;
+
+#ifdef CLASSYVOXELIZER_STATS
+    _num_sets++;
+    _num_overwrites += _occupancy.test(voxel_id);
+#endif
+
+    _voxelgrid.set(voxel_id, payload);
+    if (payload == Traits::empty())
+        _occupancy.reset(voxel_id);
+    else
+        _occupancy.set(voxel_id);
+}
+
+template <typename Payload, typename Storage>
+Payload VoxelGrid<Payload, Storage>::getVoxel(uint64_t voxel_id) {
+
+    if(voxel_id < _num_voxels)
+        return _voxelgrid.get(voxel_id);
+
+    return Traits::empty();
+}
+
+template <typename Payload, typename Storage>
+Eigen::Vector3i VoxelGrid<Payload, Storage>::getVoxelsPerDim() {
+    return _voxels_per_dim;
+}
+
+template <typename Payload, typename Storage>
+VoxelBox VoxelGrid<Payload, Storage>::getRegion() {
+    return _region;
+}
+
+// Voxel coordinates are monotonic in the point coordinates, so the corners of the bounding box bound those of every
+// point in it. Points past the last row (or slice) have ids of the next one, so boxes reaching that far are never ruled out.
+template <typename Payload, typename Storage>
+bool VoxelGrid<Payload, Storage>::mayReachRegion(const Eigen::Vector3f vertices[3]) {
+
+    if (!_clipped)
+        return true;
+
+    Eigen::Vector3f lower = _indexer.getVoxelCoordinates(vertices[0].cwiseMin(vertices[1]).cwiseMin(vertices[2]));
+    Eigen::Vector3f upper = _indexer.getVoxelCoordinates(vertices[0].cwiseMax(vertices[1]).cwiseMax(vertices[2]));
+
+    if (upper[0] >= _voxels_per_dim[0] || upper[1] >= _voxels_per_dim[1])
+        return true;
+
+    for (int axis = 0; axis < 3; axis++) {
+        if (upper[axis] < _region.begin[axis] || lower[axis] >= _region.end[axis])
+            return false;
+    }
+
+    return true;
+}
+
+template <typename Payload, typename Storage>
+std::vector<Payload> VoxelGrid<Payload, Storage>::getVoxelGrid() {
+
+    std::vector<Payload> voxelgrid(_num_voxels);
+    for (uint64_t voxel_id = 0; voxel_id < _num_voxels; voxel_id++)
+        voxelgrid[voxel_id] = _voxelgrid.get(voxel_id);
+
+    return voxelgrid;
+}
+
+template <typename Payload, typename Storage>
+void VoxelGrid<Payload, Storage>::saveAsRAW(std::string filepath) {
+
+    std::ofstream output_file(filepath);
+
+    for (uint64_t voxel_id = 0; voxel_id < _num_voxels; voxel_id++) {
+        Traits::writeRAW(output_file, _voxelgrid.get(voxel_id));
+        output_file << std::endl;
+    }
+    output_file.close();
+}
+
+template <typename Payload, typename Storage>
+void VoxelGrid<Payload, Storage>::saveAsPLY(std::string filepath, bool dense) {
+    saveAsPLY(filepath, std::vector<Eigen::Vector3i>(), dense);
+}
+
+// Streams the exported voxels straight from the grid, so export memory does not grow with the number of voxels
+template <typename Payload, typename Storage>
+void VoxelGrid<Payload, Storage>::saveAsPLY(std::string filepath, std::vector<Eigen::Vector3i> class_color_mapping, bool dense) {
+
+    STATS_PHASE("save");
+    TRACE_SPAN_DETAIL("save", filepath);
+
+    uint64_t num_exported = dense ? (_region.end - _region.begin).cwiseMax(0).cast<int64_t>().prod() : getNumOccupied();
+    PLYStreamWriter output_file(filepath, "vertex", num_exported, {"float x", "float y", "float z", "uchar red", "uchar green", "uchar blue", "uchar alpha"});
+
+    forEachExportedVoxel(dense, [&](uint64_t voxel_id, int i, int j, int k) {
+
+        Eigen::Vector3i color = Traits::toColor(_voxelgrid.get(voxel_id), class_color_mapping);
+        Eigen::Vector3f voxel_pos = getVoxelCenter(i, j, k);
+
+        output_file.write(voxel_pos[0]);
+        output_file.write(voxel_pos[1]);
+        output_file.write(voxel_pos[2]);
+
+        output_file.write((uint8_t) color[0]);
+        output_file.write((uint8_t) color[1]);
+        output_file.write((uint8_t) color[2]);
+        output_file.write((uint8_t) 255);
+    });
+
+    output_file.close();
+
+}
+
+template <typename Payload, typename Storage>
+void VoxelGrid<Payload, Storage>::saveAsPLYWithLabelProperties(std::string filepath, std::vector<Eigen::Vector3i> class_color_mapping, bool dense) {
+
+    STATS_PHASE("save");
+    TRACE_SPAN_DETAIL("save", filepath);
+
+    uint64_t num_exported = dense ? (_region.end - _region.begin).cwiseMax(0).cast<int64_t>().prod() : getNumOccupied();
+    PLYStreamWriter output_file(filepath, "vertex", num_exported, {"float x", "float y", "float z", "uchar label"});
+
+    forEachExportedVoxel(dense, [&](uint64_t voxel_id, int i, int j, int k) {
+
+        Eigen::Vector3f voxel_pos = getVoxelCenter(i, j, k);
+
+        output_file.write(voxel_pos[0]);
+        output_file.write(voxel_pos[1]);
+        output_file.write(voxel_pos[2]);
+
+        output_file.write((uint8_t) _voxelgrid.get(voxel_id));
+    });
+
+    output_file.close();
+
+}
+
+// The octree spans the smallest power of two of voxels covering the grid. Slabs of slices collect and sort their
+// occupied voxels by Morton code in parallel, the sorted slabs are then merged into the leaves.
+template <typename Payload, typename Storage>
+void VoxelGrid<Payload, Storage>::saveAsSVO(std::string filepath, unsigned int num_threads) {
+
+    STATS_PHASE("save");
+    TRACE_SPAN_DETAIL("save", filepath);
+
+    uint32_t num_levels = 1;
+    while (((int64_t) 1 << (num_levels - 1)) < _voxels_per_dim.maxCoeff())
+        num_levels++;
+
+    if (num_levels > 22)
+        throw std::runtime_error("VoxelGrid: too many voxels per dimension for an octree");
+
+    typedef std::pair<uint64_t, Payload> Leaf;
+
+    uint64_t voxels_per_slice = (uint64_t) _voxels_per_dim[0] * _voxels_per_dim[1];
+    int num_slices = _voxels_per_dim[2];
+    unsigned int num_slabs = std::max(1, std::min<int>(resolveNumThreads(num_threads), num_slices));
+    std::vector<std::vector<Leaf>> slabs(num_slabs);
+
+    auto collectSlab = [&](unsigned int slab_i) {
+
+        TRACE_SPAN("collect_slab");
+
+        uint64_t begin = voxels_per_slice * (num_slices * slab_i / num_slabs);
+        uint64_t end = voxels_per_slice * (num_slices * (slab_i + 1) / num_slabs);
+
+        _occupancy.forEachSet(begin, end, [&](uint64_t voxel_id) {
+            uint64_t slice_offset = voxel_id % voxels_per_slice;
+            uint64_t code = encodeMorton(slice_offset % _voxels_per_dim[0], slice_offset / _voxels_per_dim[0], voxel_id / voxels_per_slice);
+            slabs[slab_i].push_back(Leaf(code, _voxelgrid.get(voxel_id)));
+        });
+
+        std::sort(slabs[slab_i].begin(), slabs[slab_i].end(), [](const Leaf &a, const Leaf &b) { return a.first < b.first; });
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned int slab_i = 1; slab_i < num_slabs; slab_i++)
+        threads.emplace_back(collectSlab, slab_i);
+    collectSlab(0);
+    for (auto &thread : threads)
+        thread.join();
+
+    std::vector<Leaf> leaves;
+    for (auto &slab : slabs) {
+        size_t middle = leaves.size();
+        leaves.insert(leaves.end(), slab.begin(), slab.end());
+        std::vector<Leaf>().swap(slab);
+        std::inplace_merge(leaves.begin(), leaves.begin() + middle, leaves.end(), [](const Leaf &a, const Leaf &b) { return a.first < b.first; });
+    }
+
+    SparseVoxelOctree<Payload> octree(leaves, num_levels, num_threads);
+    octree.save(filepath, _grid_min, _voxel_size);
+}
+
+template <typename Payload, typename Storage>
+void VoxelGrid<Payload, Storage>::saveAsPartial(std::string filepath, std::vector<Eigen::Vector3i> class_color_mapping) {
+
+    STATS_PHASE("save");
+    TRACE_SPAN_DETAIL("save", filepath);
+
+    std::ofstream output_file(filepath, std::ios::binary);
+    if (!output_file)
+        throw std::runtime_error("VoxelGrid: could not open " + filepath);
+
+    PartialGridHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "CVXP", 4);
+    header.version = PARTIALVOXELGRID_VERSION;
+    header.payload_size = sizeof(Payload);
+    header.num_classes = class_color_mapping.size();
+    for (int i = 0; i < 3; i++) {
+        header.grid_min[i] = _grid_min[i];
+        header.grid_max[i] = _grid_max[i];
+        header.region_begin[i] = _region.begin[i];
+        header.region_end[i] = _region.end[i];
+    }
+    header.voxel_size = _voxel_size;
+    header.num_voxels = getNumOccupied();
+    output_file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    for (const Eigen::Vector3i &color : class_color_mapping)
+        output_file.write(reinterpret_cast<const char *>(color.data()), 3 * sizeof(int32_t));
+
+    const size_t record_size = sizeof(uint64_t) + sizeof(Payload);
+    const size_t chunk_size = PARTIALVOXELGRID_CHUNK_VOXELS * record_size;
+    std::vector<char> buffer;
+    buffer.reserve(chunk_size);
+
+    _occupancy.forEachSet([&](uint64_t voxel_id) {
+
+        Payload payload = _voxelgrid.get(voxel_id);
+        size_t offset = buffer.size();
+        buffer.resize(offset + record_size);
+        memcpy(&buffer[offset], &voxel_id, sizeof(uint64_t));
+        memcpy(&buffer[offset + sizeof(uint64_t)], &payload, sizeof(Payload));
+
+        if (buffer.size() >= chunk_size) {
+            output_file.write(buffer.data(), buffer.size());
+            buffer.clear();
+        }
+    });
+
+    output_file.write(buffer.data(), buffer.size());
+    STATS_ADD(BYTES_WRITTEN, output_file.tellp());
+    output_file.close();
+
+    if (!output_file)
+        throw std::runtime_error("VoxelGrid: could not write " + filepath);
+}
+
+// Dense exports visit every voxel of the region with i outermost and k fastest, as they always have; sparse ones
+// visit the occupied voxels in voxel id order.
+template <typename Payload, typename Storage>
+template <typename Func>
+void VoxelGrid<Payload, Storage>::forEachExportedVoxel(bool dense, Func func) {
+
+    if (!dense) {
+        uint64_t voxels_per_slice = (uint64_t) _voxels_per_dim[0] * _voxels_per_dim[1];
+        _occupancy.forEachSet([&](uint64_t voxel_id) {
+            uint64_t slice_offset = voxel_id % voxels_per_slice;
+            func(voxel_id, slice_offset % _voxels_per_dim[0], slice_offset / _voxels_per_dim[0], voxel_id / voxels_per_slice);
+        });
+        return;
+    }
+
+    for (int i = _region.begin[0]; i < _region.end[0]; i++) {
+        for (int j = _region.begin[1]; j < _region.end[1]; j++) {
+            for (int k = _region.begin[2]; k < _region.end[2]; k++)
+                func(getVoxelID(i, j, k), i, j, k);
+        }
+    }
+}
+
+template <typename Payload, typename Storage>
+uint64_t VoxelGrid<Payload, Storage>::getNumOccupied() {
+    return _occupancy.count();
+}
+
+// Threads take slabs of coarse slices. A coarse slice gathers the occupied voxels of its two fine slices, sorted by
+// coarse voxel, so the work follows the occupied voxels rather than the volume of the grid. The reduced voxels are
+// set in the coarse grid serially, which keeps the storage single-threaded.
+template <typename Payload, typename Storage>
+VoxelGrid<Payload, Storage> VoxelGrid<Payload, Storage>::downsample(unsigned int num_threads) {
+
+    STATS_PHASE("downsample");
+    TRACE_SPAN("downsample");
+
+    Eigen::Vector3i coarse_voxels_per_dim = (_voxels_per_dim.array() + 1) / 2;
+    float coarse_voxel_size = 2 * _voxel_size;
+
+    // half a voxel beyond the last coarse voxel, so the constructor truncates to exactly coarse_voxels_per_dim
+    Eigen::Vector3f coarse_max = _grid_min + (coarse_voxels_per_dim.cast<float>().array() + 0.5f).matrix() * coarse_voxel_size;
+    VoxelGrid coarse(_grid_min, coarse_max, coarse_voxel_size, VoxelBox(_region.begin / 2, (_region.end.array() + 1) / 2));
+
+    uint64_t voxels_per_slice = (uint64_t) _voxels_per_dim[0] * _voxels_per_dim[1];
+    uint64_t coarse_voxels_per_slice = (uint64_t) coarse_voxels_per_dim[0] * coarse_voxels_per_dim[1];
+    int num_coarse_slices = coarse_voxels_per_dim[2];
+
+    unsigned int num_slabs = std::max(1, std::min<int>(resolveNumThreads(num_threads), num_coarse_slices));
+    std::vector<std::vector<std::pair<uint64_t, Payload>>> reduced(num_slabs);
+
+    auto reduceSlab = [&](unsigned int slab_i) {
+
+        TRACE_SPAN("reduce_slab");
+
+        std::vector<std::pair<uint64_t, Payload>> children;
+
+        int slab_begin = (int) ((uint64_t) num_coarse_slices * slab_i / num_slabs);
+        int slab_end = (int) ((uint64_t) num_coarse_slices * (slab_i + 1) / num_slabs);
+
+        for (int coarse_k = slab_begin; coarse_k < slab_end; coarse_k++) {
+
+            uint64_t begin = 2 * coarse_k * voxels_per_slice;
+            uint64_t end = std::min<uint64_t>(begin + 2 * voxels_per_slice, _num_voxels);
+
+            children.clear();
+            _occupancy.forEachSet(begin, end, [&](uint64_t voxel_id) {
+                uint64_t slice_offset = voxel_id % voxels_per_slice;
+                uint64_t coarse_id = coarse_voxels_per_slice * coarse_k + (uint64_t) coarse_voxels_per_dim[0] * (slice_offset / _voxels_per_dim[0] / 2) + slice_offset % _voxels_per_dim[0] / 2;
+                children.push_back(std::make_pair(coarse_id, _voxelgrid.get(voxel_id)));
+            });
+
+            std::stable_sort(children.begin(), children.end(), [](const std::pair<uint64_t, Payload> &a, const std::pair<uint64_t, Payload> &b) { return a.first < b.first; });
+
+            Payload siblings[8];
+            for (size_t first = 0; first < children.size(); ) {
+                int num_siblings = 0;
+                for (size_t i = first; i < children.size() && children[i].first == children[first].first; i++)
+                    siblings[num_siblings++] = children[i].second;
+                reduced[slab_i].push_back(std::make_pair(children[first].first, Traits::reduce(siblings, num_siblings)));
+                first += num_siblings;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned int slab_i = 1; slab_i < num_slabs; slab_i++)
+        threads.emplace_back(reduceSlab, slab_i);
+    reduceSlab(0);
+    for (auto &thread : threads)
+        thread.join();
+
+    for (const auto &slab : reduced) {
+        for (const auto &voxel : slab)
+            coarse.setVoxel(voxel.first, voxel.second);
+    }
+
+    coarse.recordSetStats();
+    return coarse;
+}
+
+template <typename Payload, typename Storage>
+void VoxelGrid<Payload, Storage>::recordSetStats() {
+
+    STATS_ADD(VOXELS_SET, _num_sets);
+    STATS_ADD(VOXELS_OVERWRITTEN, _num_overwrites);
+    _num_sets = 0;
+    _num_overwrites = 0;
+}
+
+#endif /* defined(__VOXELGRID__) */
@@ -0,0 +1,69 @@
+/*
+ Classy Voxelizer
+
+ BSD 2-Clause License
+ Copyright (c) 2018, Dario Rethage
+ See LICENSE at package root for full license
+ */
+
+#ifndef __VOXELINDEXER__
+#define __VOXELINDEXER__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+
+//Eigen
+#include <Eigen/Dense>
+
+// Maps points to the IDs of the voxels enclosing them: x varies fastest, then y, then z.
+// Points are quantized by multiplying their offset from the grid origin with the precomputed inverse voxel size,
+// IDs are computed in 64-bit integer arithmetic. Points outside [grid_min, grid_max] map to -1.
+class VoxelIndexer {
+public:
+    VoxelIndexer() {}
+    VoxelIndexer(Eigen::Vector3f grid_min, Eigen::Vector3f grid_max, float voxel_size, Eigen::Vector3i voxels_per_dim);
+
+    int64_t getEnclosingVoxelID(const Eigen::Vector3f &vertex) const;
+
+    // The voxel coordinates getEnclosingVoxelID computes for a vertex, before they are checked against the grid
+    Eigen::Vector3f getVoxelCoordinates(const Eigen::Vector3f &vertex) const;
+
+    // Same result as getEnclosingVoxelID for every vertex, using AVX2 or SSE2 kernels where the CPU supports them
+    void getEnclosingVoxelIDs(const Eigen::Vector3f *vertices, size_t num_vertices, int64_t *voxel_ids) const;
+
+private:
+    void getEnclosingVoxelIDsScalar(const Eigen::Vector3f *vertices, size_t num_vertices, int64_t *voxel_ids) const;
+    void getEnclosingVoxelIDsSSE2(const Eigen::Vector3f *vertices, size_t num_vertices, int64_t *voxel_ids) const;
+    void getEnclosingVoxelIDsAVX2(const Eigen::Vector3f *vertices, size_t num_vertices, int64_t *voxel_ids) const;
+
+    Eigen::Vector3f _grid_min;
+    Eigen::Vector3f _grid_max;
+    float _inverse_voxel_size;
+    int64_t _voxels_per_row;
+    int64_t _voxels_per_slice;
+
+};
+
+inline int64_t VoxelIndexer::getEnclosingVoxelID(const Eigen::Vector3f &vertex) const {
+
+    if (!(vertex[0] >= _grid_min[0] && vertex[1] >= _grid_min[1] && vertex[2] >= _grid_min[2] &&
+          vertex[0] <= _grid_max[0] && vertex[1] <= _grid_max[1] && vertex[2] <= _grid_max[2]))
+        return -1;
+
+    int64_t i = (int64_t) std::floor((vertex[0] - _grid_min[0]) * _inverse_voxel_size);
+    int64_t j = (int64_t) std::floor((vertex[1] - _grid_min[1]) * _inverse_voxel_size);
+    int64_t k = (int64_t) std::floor((vertex[2] - _grid_min[2]) * _inverse_voxel_size);
+
+    return _voxels_per_slice * k + _voxels_per_row * j + i;
+}
+
+inline Eigen::Vector3f VoxelIndexer::getVoxelCoordinates(const Eigen::Vector3f &vertex) const {
+
+    return Eigen::Vector3f(std::floor((vertex[0] - _grid_min[0]) * _inverse_voxel_size),
+                           std::floor((vertex[1] - _grid_min[1]) * _inverse_voxel_size),
+                           std::floor((vertex[2] - _grid_min[2]) * _inverse_voxel_size));
+}
+
+#endif /* defined(__VOXELINDEXER__) */
@@ -0,0 +1,168 @@
+/*
+ Classy Voxelizer
+
+ BSD 2-Clause License
+ Copyright (c) 2018, Dario Rethage
+ See LICENSE at package root for full license
+ */
+
+#ifndef __VOXELPAYLOAD__
+#define __VOXELPAYLOAD__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <vector>
+#include <string>
+#include <ostream>
+
+//Eigen
+#include <Eigen/Dense>
+
+#include "TriangleVoxelCoverage.h"
+
+// RGB color and an alpha byte in 4 bytes; alpha 0 marks an uncolored voxel, colors are opaque
+struct PackedColor {
+    uint8_t rgba[4];
+
+    PackedColor() : rgba{0, 0, 0, 0} {}
+    PackedColor(int red, int green, int blue) : rgba{(uint8_t) red, (uint8_t) green, (uint8_t) blue, 255} {}
+
+    uint8_t operator[](int i) const { return rgba[i]; }
+    bool operator==(const PackedColor &other) const {
+        return rgba[0] == other.rgba[0] && rgba[1] == other.rgba[1] && rgba[2] == other.rgba[2] && rgba[3] == other.rgba[3];
+    }
+};
+
+// What a voxel stores and how the voxelizer derives it from the payloads of the mesh vertices:
+//   empty()                                  payload of a voxel no face reached
+//   midpoint(a, b, selector)                 payload of the midpoint of an edge a-b, selector is a hash of the midpoint
+//                                            (see Voxelizer::getMidpointSelector)
+//   MIDPOINT_USES_SELECTOR                   whether midpoint() depends on the selector at all
+//   interpolate(corners, covered_voxel)      payload of a voxel covered by a face with the given corner payloads
+//   reduce(children, num_children)           payload of a voxel twice the size, from its 1 to 8 occupied children
+//   toColor(payload, class_color_mapping)    color the voxel is exported with
+//   writeRAW(output, payload)                text representation in RAW exports
+template <typename Payload>
+struct VoxelPayloadTraits;
+
+// Class labels, 0 means unlabeled
+template <>
+struct VoxelPayloadTraits<uint8_t> {
+
+    static uint8_t empty() { return 0; }
+
+    // midpoints take the class of one of the edge's vertices, picked by the selector
+    static const bool MIDPOINT_USES_SELECTOR = true;
+    static uint8_t midpoint(uint8_t a, uint8_t b, uint64_t selector) {
+        return (selector % 2 == 0) ? a : b;
+    }
+
+    static uint8_t interpolate(const uint8_t corners[3], const TriangleVoxelCoverage::CoveredVoxel &covered_voxel) {
+        return corners[TriangleVoxelCoverage::getClosestCorner(covered_voxel)];
+    }
+
+    // the most frequent class, the lowest one on ties like MajorityReducer
+    static uint8_t reduce(const uint8_t *children, int num_children) {
+        uint8_t majority = children[0];
+        int majority_count = 0;
+        for (int i = 0; i < num_children; i++) {
+            int count = 0;
+            for (int j = 0; j < num_children; j++)
+                count += (children[j] == children[i]);
+            if (count > majority_count || (count == majority_count && children[i] < majority)) {
+                majority = children[i];
+                majority_count = count;
+            }
+        }
+        return majority;
+    }
+
+    static Eigen::Vector3i toColor(uint8_t class_i, const std::vector<Eigen::Vector3i> &class_color_mapping) {
+        if (class_color_mapping.empty() || class_i == 0)
+            return Eigen::Vector3i(255, 255, 255);
+        return class_color_mapping[class_i-1];
+    }
+
+    static void writeRAW(std::ostream &output, uint8_t class_i) {
+        output << std::to_string(class_i);
+    }
+};
+
+// RGB colors, (-1, -1, -1) means uncolored
+template <>
+struct VoxelPayloadTraits<Eigen::Vector3i> {
+
+    static Eigen::Vector3i empty() { return Eigen::Vector3i(-1, -1, -1); }
+
+    static const bool MIDPOINT_USES_SELECTOR = false;
+    static Eigen::Vector3i midpoint(const Eigen::Vector3i &a, const Eigen::Vector3i &b, uint64_t selector) {
+        return (a + b) / 2;
+    }
+
+    // the face color interpolated at the voxel center, in double precision so that the rounding does not depend on
+    // how the compiler orders the sum in each place it is inlined (serial and parallel runs must agree)
+    static Eigen::Vector3i interpolate(const Eigen::Vector3i corners[3], const TriangleVoxelCoverage::CoveredVoxel &covered_voxel) {
+        Eigen::Vector3d color(0, 0, 0);
+        for (int i = 0; i < 3; i++)
+            color += (double) covered_voxel.weights[i] * corners[i].cast<double>();
+        return color.array().round().cast<int>();
+    }
+
+    // the rounded mean color
+    static Eigen::Vector3i reduce(const Eigen::Vector3i *children, int num_children) {
+        Eigen::Vector3i sum(0, 0, 0);
+        for (int i = 0; i < num_children; i++)
+            sum += children[i];
+        return (sum.array() + num_children / 2) / num_children;
+    }
+
+    static Eigen::Vector3i toColor(const Eigen::Vector3i &color, const std::vector<Eigen::Vector3i> &class_color_mapping) {
+        return (color == empty()) ? Eigen::Vector3i(255, 255, 255) : color;
+    }
+
+    static void writeRAW(std::ostream &output, const Eigen::Vector3i &color) {
+        output << std::to_string(color[0]) << " " << std::to_string(color[1]) << " " << std::to_string(color[2]);
+    }
+};
+
+// Packed RGB colors, the compact equivalent of Eigen::Vector3i colors
+template <>
+struct VoxelPayloadTraits<PackedColor> {
+
+    static PackedColor empty() { return PackedColor(); }
+
+    static const bool MIDPOINT_USES_SELECTOR = false;
+    static PackedColor midpoint(const PackedColor &a, const PackedColor &b, uint64_t selector) {
+        return PackedColor((a[0] + b[0]) / 2, (a[1] + b[1]) / 2, (a[2] + b[2]) / 2);
+    }
+
+    // the face color interpolated at the voxel center, in double precision like the Eigen::Vector3i colors
+    static PackedColor interpolate(const PackedColor corners[3], const TriangleVoxelCoverage::CoveredVoxel &covered_voxel) {
+        Eigen::Vector3d color(0, 0, 0);
+        for (int i = 0; i < 3; i++)
+            color += (double) covered_voxel.weights[i] * Eigen::Vector3d(corners[i][0], corners[i][1], corners[i][2]);
+        Eigen::Vector3i rounded = color.array().round().cast<int>();
+        return PackedColor(rounded[0], rounded[1], rounded[2]);
+    }
+
+    // the rounded mean color, like AveragingReducer
+    static PackedColor reduce(const PackedColor *children, int num_children) {
+        int sums[3] = {0, 0, 0};
+        for (int i = 0; i < num_children; i++) {
+            for (int channel = 0; channel < 3; channel++)
+                sums[channel] += children[i][channel];
+        }
+        return PackedColor((sums[0] + num_children / 2) / num_children, (sums[1] + num_children / 2) / num_children, (sums[2] + num_children / 2) / num_children);
+    }
+
+    static Eigen::Vector3i toColor(const PackedColor &color, const std::vector<Eigen::Vector3i> &class_color_mapping) {
+        return (color == empty()) ? Eigen::Vector3i(255, 255, 255) : Eigen::Vector3i(color[0], color[1], color[2]);
+    }
+
+    static void writeRAW(std::ostream &output, const PackedColor &color) {
+        output << std::to_string(color[0]) << " " << std::to_string(color[1]) << " " << std::to_string(color[2]);
+    }
+};
+
+#endif /* defined(__VOXELPAYLOAD__) */
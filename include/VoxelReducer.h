@@ -0,0 +1,230 @@
+/*
+ Classy Voxelizer
+
+ BSD 2-Clause License
+ Copyright (c) 2018, Dario Rethage
+ See LICENSE at package root for full license
+ */
+
+#ifndef __VOXELREDUCER__
+#define __VOXELREDUCER__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <vector>
+#include <memory>
+
+#include "VoxelStorage.h"
+
+#define MAJORITYREDUCER_INLINE_CLASSES 4
+
+// Reducers merge the payloads the voxelizer writes into the same voxel.
+// The voxelizer default-constructs one per run, passes every write, in serial order, to
+// write(voxel_grid, voxel_id, payload) and calls finish(voxel_grid) once all faces are voxelized.
+// ORDER_INDEPENDENT reducers produce the same grid whatever order the writes arrive in.
+
+// The last write to a voxel wins
+template <typename Payload>
+struct LastWriteReducer {
+
+    static const bool ORDER_INDEPENDENT = false;
+
+    template <typename Grid>
+    void write(Grid &voxel_grid, uint64_t voxel_id, const Payload &payload) {
+        voxel_grid.setVoxel(voxel_id, payload);
+    }
+
+    template <typename Grid>
+    void finish(Grid &voxel_grid) {}
+};
+
+// Every voxel takes the class written to it most often, the lowest one on ties.
+// Voxels keep the counts of their first 4 classes inline; only voxels hit by more classes spill into a list.
+// Counts live in a side table for the written voxels only, the grid itself is set by finish().
+template <typename Payload>
+class MajorityReducer {
+public:
+    static const bool ORDER_INDEPENDENT = true;
+
+    template <typename Grid>
+    void write(Grid &voxel_grid, uint64_t voxel_id, const Payload &payload);
+
+    template <typename Grid>
+    void finish(Grid &voxel_grid);
+
+private:
+    struct Histogram {
+        Payload classes[MAJORITYREDUCER_INLINE_CLASSES];
+        uint32_t counts[MAJORITYREDUCER_INLINE_CLASSES];
+        uint32_t spill_ref;   // index into _spills + 1, 0 if there is no spill list
+    };
+
+    void vote(Histogram &histogram, const Payload &payload);
+
+    // histogram index + 1 per voxel, 0 for voxels never written to
+    std::unique_ptr<SparseVoxelStorage<uint32_t>> _histogram_refs;
+    std::vector<Histogram> _histograms;
+    std::vector<std::vector<std::pair<Payload, uint32_t>>> _spills;
+    uint64_t _num_voxels = 0;
+};
+
+template <typename Payload>
+template <typename Grid>
+void MajorityReducer<Payload>::write(Grid &voxel_grid, uint64_t voxel_id, const Payload &payload) {
+
+    if (!_histogram_refs) {
+        _histogram_refs.reset(new SparseVoxelStorage<uint32_t>(voxel_grid.getVoxelsPerDim(), 0));
+        _num_voxels = voxel_grid.getVoxelsPerDim().template cast<int64_t>().prod();
+    }
+
+    if (voxel_id >= _num_voxels)
+        return;
+
+    uint32_t &histogram_ref = _histogram_refs->at(voxel_id);
+    if (histogram_ref == 0) {
+        _histograms.push_back(Histogram());
+        histogram_ref = _histograms.size();
+    }
+
+    vote(_histograms[histogram_ref - 1], payload);
+}
+
+template <typename Payload>
+void MajorityReducer<Payload>::vote(Histogram &histogram, const Payload &payload) {
+
+    for (int i = 0; i < MAJORITYREDUCER_INLINE_CLASSES; i++) {
+
+        if (histogram.counts[i] == 0) {
+            histogram.classes[i] = payload;
+            histogram.counts[i] = 1;
+            return;
+        }
+
+        if (histogram.classes[i] == payload) {
+            histogram.counts[i]++;
+            return;
+        }
+    }
+
+    if (histogram.spill_ref == 0) {
+        _spills.emplace_back();
+        histogram.spill_ref = _spills.size();
+    }
+
+    for (auto &entry : _spills[histogram.spill_ref - 1]) {
+        if (entry.first == payload) {
+            entry.second++;
+            return;
+        }
+    }
+
+    _spills[histogram.spill_ref - 1].push_back(std::make_pair(payload, 1));
+}
+
+template <typename Payload>
+template <typename Grid>
+void MajorityReducer<Payload>::finish(Grid &voxel_grid) {
+
+    if (!_histogram_refs)
+        return;
+
+    _histogram_refs->forEachVoxel([&](uint64_t voxel_id, uint32_t histogram_ref) {
+
+        if (histogram_ref == 0)
+            return;
+
+        const Histogram &histogram = _histograms[histogram_ref - 1];
+        Payload majority = histogram.classes[0];
+        uint32_t majority_count = histogram.counts[0];
+
+        auto consider = [&](const Payload &class_i, uint32_t count) {
+            if (count > majority_count || (count == majority_count && class_i < majority)) {
+                majority = class_i;
+                majority_count = count;
+            }
+        };
+
+        for (int i = 1; i < MAJORITYREDUCER_INLINE_CLASSES && histogram.counts[i] > 0; i++)
+            consider(histogram.classes[i], histogram.counts[i]);
+
+        if (histogram.spill_ref != 0) {
+            for (const auto &entry : _spills[histogram.spill_ref - 1])
+                consider(entry.first, entry.second);
+        }
+
+        voxel_grid.setVoxel(voxel_id, majority);
+    });
+}
+
+// Every voxel takes the rounded mean of the colors written to it. Payload must be indexable by channel and
+// constructible from (red, green, blue). Channel sums live in a side table for the written voxels only,
+// the grid itself is set by finish().
+template <typename Payload>
+class AveragingReducer {
+public:
+    static const bool ORDER_INDEPENDENT = true;
+
+    template <typename Grid>
+    void write(Grid &voxel_grid, uint64_t voxel_id, const Payload &payload);
+
+    template <typename Grid>
+    void finish(Grid &voxel_grid);
+
+private:
+    struct Accumulator {
+        uint32_t sums[3];
+        uint32_t count;
+    };
+
+    // accumulator index + 1 per voxel, 0 for voxels never written to
+    std::unique_ptr<SparseVoxelStorage<uint32_t>> _accumulator_refs;
+    std::vector<Accumulator> _accumulators;
+    uint64_t _num_voxels = 0;
+};
+
+template <typename Payload>
+template <typename Grid>
+void AveragingReducer<Payload>::write(Grid &voxel_grid, uint64_t voxel_id, const Payload &payload) {
+
+    if (!_accumulator_refs) {
+        _accumulator_refs.reset(new SparseVoxelStorage<uint32_t>(voxel_grid.getVoxelsPerDim(), 0));
+        _num_voxels = voxel_grid.getVoxelsPerDim().template cast<int64_t>().prod();
+    }
+
+    if (voxel_id >= _num_voxels)
+        return;
+
+    uint32_t &accumulator_ref = _accumulator_refs->at(voxel_id);
+    if (accumulator_ref == 0) {
+        _accumulators.push_back(Accumulator());
+        accumulator_ref = _accumulators.size();
+    }
+
+    Accumulator &accumulator = _accumulators[accumulator_ref - 1];
+    for (int i = 0; i < 3; i++)
+        accumulator.sums[i] += payload[i];
+    accumulator.count++;
+}
+
+template <typename Payload>
+template <typename Grid>
+void AveragingReducer<Payload>::finish(Grid &voxel_grid) {
+
+    if (!_accumulator_refs)
+        return;
+
+    _accumulator_refs->forEachVoxel([&](uint64_t voxel_id, uint32_t accumulator_ref) {
+
+        if (accumulator_ref == 0)
+            return;
+
+        const Accumulator &accumulator = _accumulators[accumulator_ref - 1];
+        uint32_t half = accumulator.count / 2;
+        voxel_grid.setVoxel(voxel_id, Payload((accumulator.sums[0] + half) / accumulator.count,
+                                              (accumulator.sums[1] + half) / accumulator.count,
+                                              (accumulator.sums[2] + half) / accumulator.count));
+    });
+}
+
+#endif /* defined(__VOXELREDUCER__) */
@@ -0,0 +1,238 @@
+/*
+ Classy Voxelizer
+
+ BSD 2-Clause License
+ Copyright (c) 2018, Dario Rethage
+ See LICENSE at package root for full license
+ */
+
+#ifndef __VOXELSTORAGE__
+#define __VOXELSTORAGE__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+//Eigen
+#include <Eigen/Dense>
+
+#define SPARSEVOXELSTORAGE_BRICK_BITS 3
+#define SPARSEVOXELSTORAGE_INITIAL_SLOTS 1024
+
+// Storage policies hold one payload per voxel of a VoxelGrid.
+// They are constructed with the grid's voxels per dimension and the payload of an empty voxel,
+// and are only ever accessed with voxel ids inside the grid. forEachVoxel(func) calls func(voxel_id, payload)
+// for every voxel the storage holds memory for; all other voxels are empty.
+
+// One payload per voxel in a flat array, x varying fastest
+template <typename Payload>
+class DenseVoxelStorage {
+public:
+    DenseVoxelStorage(Eigen::Vector3i voxels_per_dim, const Payload &empty_payload) : _voxels(voxels_per_dim.cast<int64_t>().prod(), empty_payload) {}
+
+    const Payload &get(uint64_t voxel_id) const { return _voxels[voxel_id]; }
+    void set(uint64_t voxel_id, const Payload &payload) { _voxels[voxel_id] = payload; }
+
+    template <typename Func>
+    void forEachVoxel(Func func) const {
+        for (uint64_t voxel_id = 0; voxel_id < _voxels.size(); voxel_id++)
+            func(voxel_id, _voxels[voxel_id]);
+    }
+
+private:
+    std::vector<Payload> _voxels;
+
+};
+
+// Allocates voxels in bricks of 8x8x8 on their first write, so memory scales with the surface that is voxelized
+// rather than the volume of the grid. Bricks are found through an open-addressing (linear probing) hash map keyed
+// by brick coordinates; voxels of unallocated bricks read as empty.
+template <typename Payload>
+class SparseVoxelStorage {
+public:
+    SparseVoxelStorage(Eigen::Vector3i voxels_per_dim, const Payload &empty_payload);
+
+    const Payload &get(uint64_t voxel_id) const;
+    void set(uint64_t voxel_id, const Payload &payload) { at(voxel_id) = payload; }
+
+    // The voxel's payload for in-place updates, allocating its brick if needed
+    Payload &at(uint64_t voxel_id);
+
+    // Visits the allocated bricks in allocation order
+    template <typename Func>
+    void forEachVoxel(Func func) const;
+
+    size_t getNumBricks() const { return _brick_keys.size(); }
+
+private:
+    static const int BRICK_SIZE = 1 << SPARSEVOXELSTORAGE_BRICK_BITS;
+    static const int BRICK_VOXELS = BRICK_SIZE * BRICK_SIZE * BRICK_SIZE;
+    static const uint64_t EMPTY_SLOT = UINT64_MAX;
+
+    // Brick coordinates take 21 bits each, voxel coordinates within the brick SPARSEVOXELSTORAGE_BRICK_BITS each
+    void locate(uint64_t voxel_id, uint64_t &brick_key, uint32_t &voxel_offset) const;
+    int64_t findBrick(uint64_t brick_key) const;
+    uint32_t allocateBrick(uint64_t brick_key);
+    void insertSlot(uint64_t brick_key, uint32_t brick_i);
+    uint64_t getSlot(uint64_t brick_key) const;
+
+    Eigen::Vector3i _voxels_per_dim;
+    int64_t _voxels_per_slice;
+    Payload _empty_payload;
+    std::vector<uint64_t> _slot_keys;
+    std::vector<uint32_t> _slot_bricks;
+    int _slot_bits;
+    std::vector<uint64_t> _brick_keys;
+    std::vector<std::unique_ptr<Payload[]>> _bricks;
+    uint64_t _last_brick_key;
+    uint32_t _last_brick_i;
+
+};
+
+template <typename Payload>
+const uint64_t SparseVoxelStorage<Payload>::EMPTY_SLOT;
+
+template <typename Payload>
+SparseVoxelStorage<Payload>::SparseVoxelStorage(Eigen::Vector3i voxels_per_dim, const Payload &empty_payload) {
+
+    _voxels_per_dim = voxels_per_dim;
+    _voxels_per_slice = (int64_t) voxels_per_dim[0] * voxels_per_dim[1];
+    _empty_payload = empty_payload;
+    _slot_keys.assign(SPARSEVOXELSTORAGE_INITIAL_SLOTS, EMPTY_SLOT);
+    _slot_bricks.assign(SPARSEVOXELSTORAGE_INITIAL_SLOTS, 0);
+    _slot_bits = 0;
+    while ((1 << _slot_bits) < SPARSEVOXELSTORAGE_INITIAL_SLOTS)
+        _slot_bits++;
+    _last_brick_key = EMPTY_SLOT;
+    _last_brick_i = 0;
+
+}
+
+template <typename Payload>
+void SparseVoxelStorage<Payload>::locate(uint64_t voxel_id, uint64_t &brick_key, uint32_t &voxel_offset) const {
+
+    uint64_t k = voxel_id / _voxels_per_slice;
+    uint64_t slice_offset = voxel_id - k * _voxels_per_slice;
+    uint64_t j = slice_offset / _voxels_per_dim[0];
+    uint64_t i = slice_offset - j * _voxels_per_dim[0];
+
+    const uint64_t mask = BRICK_SIZE - 1;
+    const int bits = SPARSEVOXELSTORAGE_BRICK_BITS;
+
+    brick_key = (i >> bits) | ((j >> bits) << 21) | ((k >> bits) << 42);
+    voxel_offset = (i & mask) | ((j & mask) << bits) | ((k & mask) << (2 * bits));
+}
+
+// Fibonacci hashing of the brick key onto the table
+template <typename Payload>
+uint64_t SparseVoxelStorage<Payload>::getSlot(uint64_t brick_key) const {
+    return (brick_key * 0x9E3779B97F4A7C15ull) >> (64 - _slot_bits);
+}
+
+template <typename Payload>
+int64_t SparseVoxelStorage<Payload>::findBrick(uint64_t brick_key) const {
+
+    uint64_t slot_mask = _slot_keys.size() - 1;
+    for (uint64_t slot = getSlot(brick_key); ; slot = (slot + 1) & slot_mask) {
+        if (_slot_keys[slot] == brick_key)
+            return _slot_bricks[slot];
+        if (_slot_keys[slot] == EMPTY_SLOT)
+            return -1;
+    }
+}
+
+template <typename Payload>
+void SparseVoxelStorage<Payload>::insertSlot(uint64_t brick_key, uint32_t brick_i) {
+
+    uint64_t slot_mask = _slot_keys.size() - 1;
+    uint64_t slot = getSlot(brick_key);
+    while (_slot_keys[slot] != EMPTY_SLOT)
+        slot = (slot + 1) & slot_mask;
+
+    _slot_keys[slot] = brick_key;
+    _slot_bricks[slot] = brick_i;
+}
+
+// Keeps the table at most half full, doubling it and reinserting every brick when needed
+template <typename Payload>
+uint32_t SparseVoxelStorage<Payload>::allocateBrick(uint64_t brick_key) {
+
+    if (2 * (_brick_keys.size() + 1) > _slot_keys.size()) {
+
+        _slot_bits++;
+        _slot_keys.assign((size_t) 1 << _slot_bits, EMPTY_SLOT);
+        _slot_bricks.assign((size_t) 1 << _slot_bits, 0);
+
+        for (uint32_t brick_i = 0; brick_i < _brick_keys.size(); brick_i++)
+            insertSlot(_brick_keys[brick_i], brick_i);
+    }
+
+    uint32_t brick_i = _brick_keys.size();
+    _brick_keys.push_back(brick_key);
+    _bricks.emplace_back(new Payload[BRICK_VOXELS]);
+    std::fill(_bricks.back().get(), _bricks.back().get() + BRICK_VOXELS, _empty_payload);
+    insertSlot(brick_key, brick_i);
+
+    return brick_i;
+}
+
+template <typename Payload>
+const Payload &SparseVoxelStorage<Payload>::get(uint64_t voxel_id) const {
+
+    uint64_t brick_key;
+    uint32_t voxel_offset;
+    locate(voxel_id, brick_key, voxel_offset);
+
+    int64_t brick_i = findBrick(brick_key);
+    if (brick_i < 0)
+        return _empty_payload;
+
+    return _bricks[brick_i][voxel_offset];
+}
+
+// Consecutive writes mostly land in the same brick, which is remembered to skip the lookup
+template <typename Payload>
+Payload &SparseVoxelStorage<Payload>::at(uint64_t voxel_id) {
+
+    uint64_t brick_key;
+    uint32_t voxel_offset;
+    locate(voxel_id, brick_key, voxel_offset);
+
+    if (brick_key != _last_brick_key) {
+        int64_t brick_i = findBrick(brick_key);
+        _last_brick_i = (brick_i < 0) ? allocateBrick(brick_key) : brick_i;
+        _last_brick_key = brick_key;
+    }
+
+    return _bricks[_last_brick_i][voxel_offset];
+}
+
+template <typename Payload>
+template <typename Func>
+void SparseVoxelStorage<Payload>::forEachVoxel(Func func) const {
+
+    const int bits = SPARSEVOXELSTORAGE_BRICK_BITS;
+    const uint64_t brick_mask = (1 << 21) - 1;
+
+    for (size_t brick_i = 0; brick_i < _brick_keys.size(); brick_i++) {
+
+        int64_t i_begin = (_brick_keys[brick_i] & brick_mask) << bits;
+        int64_t j_begin = ((_brick_keys[brick_i] >> 21) & brick_mask) << bits;
+        int64_t k_begin = (_brick_keys[brick_i] >> 42) << bits;
+        const Payload *brick = _bricks[brick_i].get();
+
+        for (int k = 0; k < BRICK_SIZE && k_begin + k < _voxels_per_dim[2]; k++) {
+            for (int j = 0; j < BRICK_SIZE && j_begin + j < _voxels_per_dim[1]; j++) {
+                for (int i = 0; i < BRICK_SIZE && i_begin + i < _voxels_per_dim[0]; i++) {
+                    uint64_t voxel_id = _voxels_per_slice * (k_begin + k) + _voxels_per_dim[0] * (j_begin + j) + (i_begin + i);
+                    func(voxel_id, brick[(k << (2 * bits)) | (j << bits) | i]);
+                }
+            }
+        }
+    }
+}
+
+#endif /* defined(__VOXELSTORAGE__) */
@@ -0,0 +1,843 @@
+/*
+ Classy Voxelizer
+
+ BSD 2-Clause License
+ Copyright (c) 2018, Dario Rethage
+ See LICENSE at package root for full license
+ */
+
+#ifndef __VOXELIZER__
+#define __VOXELIZER__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <memory>
+#include <math.h>
+#include <string>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+//Eigen
+#include <Eigen/Dense>
+
+#include "VoxelGrid.h"
+#include "VoxelReducer.h"
+#include "WorkStealingScheduler.h"
+#include "TriangleVoxelCoverage.h"
+#include "Stats.h"
+#include "Trace.h"
+
+#define VOXELIZER_MIN_TRIANGLE_AREA 0.00001
+#define VOXELIZER_MAX_SPLIT_DEPTH 128
+#define VOXELIZER_FACES_PER_TASK 256
+#define VOXELIZER_MIN_STEALABLE_EDGE 4
+// Face blocks per thread that are covered before their writes are applied and freed
+#define VOXELIZER_TASKS_PER_WAVE 16
+// Face blocks per thread that may be split ahead of the replay
+#define VOXELIZER_OPEN_BLOCKS_PER_THREAD 4
+// Log size (in 64-bit words) after which a face block hands its remaining faces to a new block
+#define VOXELIZER_MAX_BLOCK_OPS (1 << 18)
+// Log size per thread above which no further face blocks are opened until earlier ones are replayed
+#define VOXELIZER_MAX_LOGGED_OPS_PER_THREAD (1 << 22)
+// Faces with an edge of this many voxels or more are split into pieces below it, each logged as a block of its own,
+// as the log of the whole face would not be bounded
+#define VOXELIZER_MAX_LOGGED_EDGE 64
+
+// Voxelizes triangle meshes with one Payload per vertex into a VoxelGrid<Payload, Storage>.
+// Every voxel write goes through the Reducer (see VoxelReducer.h), all three policies are fixed at compile time.
+template <typename Payload, typename Reducer = LastWriteReducer<Payload>, typename Storage = DenseVoxelStorage<Payload>>
+class Voxelizer {
+public:
+    typedef VoxelGrid<Payload, Storage> Grid;
+    typedef VoxelPayloadTraits<Payload> Traits;
+
+    // num_threads > 1 (or 0 for all hardware threads) splits the work across threads; the result is identical to the serial one.
+    // The grid is restricted to region (see VoxelGrid); sub-faces that cannot reach it are not split any further.
+    // Midpoint payloads only depend on the midpoint (see getMidpointSelector), so faces taken out of a larger mesh get
+    // the payloads of a single pass over that mesh.
+    static Grid voxelize(const std::vector<Eigen::Vector3f> &vertices, const std::vector<uint32_t> &faces, const std::vector<Payload> &vertex_payloads, Eigen::Vector3f grid_min, Eigen::Vector3f grid_max, float voxel_size, unsigned int num_threads = 1, VoxelBox region = VoxelBox());
+    // Covers every face with separating-axis triangle/voxel tests instead of splitting it; covered voxels take the face's payloads interpolated at their center
+    static Grid voxelizeOverlap(const std::vector<Eigen::Vector3f> &vertices, const std::vector<uint32_t> &faces, const std::vector<Payload> &vertex_payloads, Eigen::Vector3f grid_min, Eigen::Vector3f grid_max, float voxel_size, TriangleVoxelCoverage::Separability separability = TriangleVoxelCoverage::CONSERVATIVE, unsigned int num_threads = 1, VoxelBox region = VoxelBox());
+    // Merges partial grids of the same grid (see VoxelGrid::saveAsPartial) into the whole grid, every voxel of every
+    // partial grid, in order, going through the Reducer, so voxels held by several partial grids are resolved like
+    // voxels hit by several faces. Returns the partial grids' class colors; throws if a file can't be read or doesn't match.
+    static Grid mergePartials(const std::vector<std::string> &filepaths, std::vector<Eigen::Vector3i> &class_color_mapping);
+
+private:
+    // A (sub-)face being split: its corners, their enclosing voxels and one attribute per corner
+    template <typename Attribute>
+    struct SubFace {
+        Eigen::Vector3f vertices[3];
+        int64_t voxel_ids[3];
+        Attribute attributes[3];
+    };
+
+    // Records, in serial order, what splitFace does for a block of faces or for one stolen sub-face:
+    // the midpoints it creates, the voxel writes of its leaf faces and where stolen sub-faces belong.
+    // Midpoint payloads depend on the payloads of their edge, so they are only resolved once the chunk is replayed.
+    // Refs below base_ref are mesh vertices (face blocks) or the three corners of the stolen sub-face.
+    // A WRITE op holds the voxel id it writes to, a WRITE_LONG op (voxel ids from 2^32 - 1 on, or -1) is followed by it.
+    // For payloads whose midpoints use the selector a MIDPOINT op is followed by it.
+    struct SplitChunk {
+        enum OpType { WRITE = 0, MIDPOINT = 1, CHILD = 2, WRITE_LONG = 3 };
+
+        uint32_t base_ref = 0;
+        uint32_t corner_refs[3] = {0, 0, 0};
+        uint32_t num_midpoints = 0;
+        std::vector<uint64_t> ops;
+        std::vector<std::unique_ptr<SplitChunk>> children;
+
+        void push(OpType type, uint32_t first, uint32_t second) {
+            ops.push_back(((uint64_t) type << 62) | ((uint64_t) first << 32) | second);
+        }
+
+        void pushWrite(uint32_t ref, int64_t voxel_id) {
+            if (voxel_id >= 0 && voxel_id < 0xffffffff) {
+                push(WRITE, ref, voxel_id);
+            } else {
+                push(WRITE_LONG, ref, 0);
+                ops.push_back(voxel_id);
+            }
+        }
+
+        void pushMidpoint(uint32_t first, uint32_t second, uint64_t selector) {
+            push(MIDPOINT, first, second);
+            if (Traits::MIDPOINT_USES_SELECTOR)
+                ops.push_back(selector);
+        }
+    };
+
+    // A range of faces in the serial order of the mesh, or a piece of a large face. It is split once started and
+    // replayed once its own task and all its stolen sub-faces are done. A piece's chunk refers to its corners, whose
+    // payloads it keeps.
+    struct SplitBlock {
+        uint32_t face_begin = 0;
+        uint32_t face_end = 0;
+        bool piece = false;
+        Payload corner_payloads[3];
+        SplitChunk chunk;
+        std::atomic<uint32_t> num_running;
+        std::atomic<uint64_t> num_ops;
+        bool started = false;
+        bool done = false;
+        std::unique_ptr<SplitBlock> next;
+    };
+
+    struct SplitTask {
+        uint32_t face_begin = 0;
+        uint32_t face_end = 0;
+        SubFace<uint32_t> sub_face;
+        SplitChunk *chunk = nullptr;
+        SplitBlock *block = nullptr;
+    };
+
+    // child_i >= 0 marks the position of a stolen sub-face in the serial order
+    struct SplitStackEntry {
+        SubFace<uint32_t> face;
+        int child_i;
+    };
+
+    static void voxelizeParallel(Grid &voxel_grid, Reducer &reducer, const std::vector<Eigen::Vector3f> &vertices, const std::vector<int64_t> &vertex_voxel_ids, const std::vector<uint32_t> &faces, const std::vector<Payload> &vertex_payloads, float voxel_size, unsigned int num_threads);
+    static void splitFaceIntoChunk(Grid &voxel_grid, const SubFace<uint32_t> &face, SplitChunk &chunk, SplitBlock *block, WorkStealingScheduler<SplitTask> &scheduler, unsigned int worker_i, float min_stealable_edge);
+    static void replayChunk(Grid &voxel_grid, Reducer &reducer, const SplitChunk &chunk, const std::vector<Payload> &vertex_payloads, const Payload corner_payloads[3]);
+
+    template <typename Attribute>
+    static uint64_t getMidpointSelector(const SubFace<Attribute> &face, int &a, int &b);
+    template <typename Attribute>
+    static bool findSplitEdge(const SubFace<Attribute> &face, int &longest_i, double &longest_length);
+    template <typename Attribute, typename Indexer>
+    static void splitAtMidpoint(Indexer &indexer, const SubFace<Attribute> &face, int longest_i, Attribute midpoint_attribute, SubFace<Attribute> &first_sub_face, SubFace<Attribute> &second_sub_face);
+
+    static Eigen::Vector3f getMidpoint(Eigen::Vector3f v1, Eigen::Vector3f v2);
+    static float euclideanDistance(Eigen::Vector3f v1, Eigen::Vector3f v2);
+    static float areaOfTriangle(Eigen::Vector3f vertex_1, Eigen::Vector3f vertex_2, Eigen::Vector3f vertex_3);
+    static void splitFace(Grid &voxel_grid, Reducer &reducer, const SubFace<Payload> &face);
+    static void recordSplitStats(uint64_t num_splits, uint64_t num_leaves, int max_stack_size);
+    static void recordGridStats(Grid &voxel_grid);
+
+};
+
+template <typename Payload, typename Reducer, typename Storage>
+VoxelGrid<Payload, Storage> Voxelizer<Payload, Reducer, Storage>::voxelize(const std::vector<Eigen::Vector3f> &vertices, const std::vector<uint32_t> &faces, const std::vector<Payload> &vertex_payloads, Eigen::Vector3f grid_min, Eigen::Vector3f grid_max, float voxel_size, unsigned int num_threads, VoxelBox region) {
+
+    STATS_PHASE("voxelize");
+    TRACE_SPAN("voxelize");
+    STATS_ADD(FACES, faces.size() / 3);
+
+    Grid voxel_grid(grid_min, grid_max, voxel_size, region);
+    Reducer reducer;
+
+    // every face corner is quantized once, in a single batch
+    std::vector<int64_t> vertex_voxel_ids(vertices.size());
+    voxel_grid.getEnclosingVoxelIDs(vertices.data(), vertices.size(), vertex_voxel_ids.data());
+
+    num_threads = resolveNumThreads(num_threads);
+    if (num_threads > 1) {
+        voxelizeParallel(voxel_grid, reducer, vertices, vertex_voxel_ids, faces, vertex_payloads, voxel_size, num_threads);
+        reducer.finish(voxel_grid);
+        recordGridStats(voxel_grid);
+        return voxel_grid;
+    }
+
+    for (size_t i = 0; i < faces.size(); i+=3) {
+
+        SubFace<Payload> face;
+        for (int j = 0; j < 3; j++) {
+            face.vertices[j] = vertices[faces[i+j]];
+            face.voxel_ids[j] = vertex_voxel_ids[faces[i+j]];
+            face.attributes[j] = vertex_payloads[faces[i+j]];
+        }
+
+        splitFace(voxel_grid, reducer, face);
+
+    }
+
+    reducer.finish(voxel_grid);
+    recordGridStats(voxel_grid);
+    return voxel_grid;
+
+}
+
+template <typename Payload, typename Reducer, typename Storage>
+VoxelGrid<Payload, Storage> Voxelizer<Payload, Reducer, Storage>::voxelizeOverlap(const std::vector<Eigen::Vector3f> &vertices, const std::vector<uint32_t> &faces, const std::vector<Payload> &vertex_payloads, Eigen::Vector3f grid_min, Eigen::Vector3f grid_max, float voxel_size, TriangleVoxelCoverage::Separability separability, unsigned int num_threads, VoxelBox region) {
+
+    STATS_PHASE("voxelize");
+    TRACE_SPAN("voxelize");
+    STATS_ADD(FACES, faces.size() / 3);
+
+    Grid voxel_grid(grid_min, grid_max, voxel_size, region);
+    Reducer reducer;
+    TriangleVoxelCoverage coverage(grid_min, voxel_grid.getVoxelsPerDim(), voxel_size, separability);
+
+    auto payload_of = [&](uint32_t face_i, const TriangleVoxelCoverage::CoveredVoxel &covered_voxel) -> Payload {
+        Payload corners[3] = {vertex_payloads[faces[3 * face_i]], vertex_payloads[faces[3 * face_i + 1]], vertex_payloads[faces[3 * face_i + 2]]};
+        return Traits::interpolate(corners, covered_voxel);
+    };
+
+    uint32_t num_faces = faces.size() / 3;
+
+    num_threads = resolveNumThreads(num_threads);
+    if (num_threads == 1) {
+
+        std::vector<TriangleVoxelCoverage::CoveredVoxel> covered;
+        for (uint32_t face_i = 0; face_i < num_faces; face_i++) {
+
+            covered.clear();
+            coverage.cover(vertices[faces[3 * face_i]], vertices[faces[3 * face_i + 1]], vertices[faces[3 * face_i + 2]], covered);
+
+            for (const auto &covered_voxel : covered)
+                reducer.write(voxel_grid, covered_voxel.voxel_id, payload_of(face_i, covered_voxel));
+            STATS_ADD(VOXEL_WRITES, covered.size());
+        }
+
+        reducer.finish(voxel_grid);
+        recordGridStats(voxel_grid);
+        return voxel_grid;
+    }
+
+    // blocks of faces are covered in parallel, a wave at a time; a wave's writes are applied in face order
+    // before the next one starts, so memory is bounded by the wave rather than the mesh
+    uint32_t num_blocks = (num_faces + VOXELIZER_FACES_PER_TASK - 1) / VOXELIZER_FACES_PER_TASK;
+    uint32_t wave_size = num_threads * VOXELIZER_TASKS_PER_WAVE;
+
+    WorkStealingScheduler<uint32_t> scheduler(num_threads);
+
+    for (uint32_t wave_begin = 0; wave_begin < num_blocks; wave_begin += wave_size) {
+
+        uint32_t wave_end = std::min(num_blocks, wave_begin + wave_size);
+        std::vector<std::vector<std::pair<uint64_t, Payload>>> block_writes(wave_end - wave_begin);
+
+        for (uint32_t block_i = wave_begin; block_i < wave_end; block_i++)
+            scheduler.push((uint64_t) (block_i - wave_begin) * num_threads / (wave_end - wave_begin), block_i);
+
+        scheduler.run([&](unsigned int worker_i, uint32_t block_i) {
+
+            TRACE_SPAN("cover_faces");
+            std::vector<TriangleVoxelCoverage::CoveredVoxel> covered;
+            uint32_t face_end = std::min(num_faces, (block_i + 1) * VOXELIZER_FACES_PER_TASK);
+
+            for (uint32_t face_i = block_i * VOXELIZER_FACES_PER_TASK; face_i < face_end; face_i++) {
+
+                covered.clear();
+                coverage.cover(vertices[faces[3 * face_i]], vertices[faces[3 * face_i + 1]], vertices[faces[3 * face_i + 2]], covered);
+
+                for (const auto &covered_voxel : covered)
+                    block_writes[block_i - wave_begin].push_back(std::make_pair(covered_voxel.voxel_id, payload_of(face_i, covered_voxel)));
+            }
+        });
+
+        TRACE_SPAN("apply_writes");
+        for (const auto &writes : block_writes) {
+            for (const auto &write : writes)
+                reducer.write(voxel_grid, write.first, write.second);
+            STATS_ADD(VOXEL_WRITES, writes.size());
+        }
+    }
+
+    reducer.finish(voxel_grid);
+    recordGridStats(voxel_grid);
+    return voxel_grid;
+
+}
+
+template <typename Payload, typename Reducer, typename Storage>
+VoxelGrid<Payload, Storage> Voxelizer<Payload, Reducer, Storage>::mergePartials(const std::vector<std::string> &filepaths, std::vector<Eigen::Vector3i> &class_color_mapping) {
+
+    STATS_PHASE("merge");
+    TRACE_SPAN("merge");
+
+    if (filepaths.empty())
+        throw std::runtime_error("Voxelizer: no partial grids to merge");
+
+    PartialVoxelGridFile first_file;
+    if (!first_file.open(filepaths[0]))
+        throw std::runtime_error("Voxelizer: could not read partial grid " + filepaths[0]);
+
+    const PartialGridHeader first = first_file.getHeader();
+    class_color_mapping = first_file.getClassColorMapping();
+
+    Grid voxel_grid(Eigen::Vector3f(first.grid_min[0], first.grid_min[1], first.grid_min[2]), Eigen::Vector3f(first.grid_max[0], first.grid_max[1], first.grid_max[2]), first.voxel_size);
+    Reducer reducer;
+
+    std::vector<std::pair<uint64_t, Payload>> voxels;
+
+    for (const std::string &filepath : filepaths) {
+
+        PartialVoxelGridFile partial_file;
+        if (!partial_file.open(filepath))
+            throw std::runtime_error("Voxelizer: could not read partial grid " + filepath);
+
+        const PartialGridHeader &header = partial_file.getHeader();
+        if (header.payload_size != sizeof(Payload))
+            throw std::runtime_error("Voxelizer: partial grid " + filepath + " holds payloads of another color mapping");
+
+        if (memcmp(header.grid_min, first.grid_min, sizeof(first.grid_min)) != 0 || memcmp(header.grid_max, first.grid_max, sizeof(first.grid_max)) != 0
+            || header.voxel_size != first.voxel_size || partial_file.getClassColorMapping() != class_color_mapping)
+            throw std::runtime_error("Voxelizer: partial grid " + filepath + " does not match " + filepaths[0]);
+
+        while (partial_file.read(voxels)) {
+            for (const auto &voxel : voxels)
+                reducer.write(voxel_grid, voxel.first, voxel.second);
+        }
+
+        if (partial_file.failed())
+            throw std::runtime_error("Voxelizer: could not read partial grid " + filepath);
+    }
+
+    reducer.finish(voxel_grid);
+    recordGridStats(voxel_grid);
+    return voxel_grid;
+}
+
+// Face blocks are split into logs in parallel and replayed in face order as soon as every block before them is.
+// Blocks are only started while their logs stay below VOXELIZER_MAX_LOGGED_OPS_PER_THREAD, except for the oldest one,
+// and at most VOXELIZER_OPEN_BLOCKS_PER_THREAD per thread wait for their replay. A block whose log grows past
+// VOXELIZER_MAX_BLOCK_OPS, or finds the budget used up, hands its remaining faces to a new block behind it.
+// Faces too large to log start a block of their own, which only starts once it is the oldest. It is then split into
+// pieces whose edges are short enough to log, handed out as blocks in the serial order of the face under the same
+// limits, so their logs are replayed and freed while the face is still being split.
+template <typename Payload, typename Reducer, typename Storage>
+void Voxelizer<Payload, Reducer, Storage>::voxelizeParallel(Grid &voxel_grid, Reducer &reducer, const std::vector<Eigen::Vector3f> &vertices, const std::vector<int64_t> &vertex_voxel_ids, const std::vector<uint32_t> &faces, const std::vector<Payload> &vertex_payloads, float voxel_size, unsigned int num_threads) {
+
+    uint32_t num_faces = faces.size() / 3;
+    uint32_t max_open_blocks = num_threads * VOXELIZER_OPEN_BLOCKS_PER_THREAD;
+    uint64_t max_logged_ops = (uint64_t) num_threads * VOXELIZER_MAX_LOGGED_OPS_PER_THREAD;
+    float min_stealable_edge = VOXELIZER_MIN_STEALABLE_EDGE * voxel_size;
+
+    WorkStealingScheduler<SplitTask> scheduler(num_threads);
+
+    // Blocks in face order from the oldest one not replayed yet. The list, the grid and the reducer are guarded by replay_mutex.
+    std::mutex replay_mutex;
+    std::unique_ptr<SplitBlock> head;
+    SplitBlock *tail = nullptr;
+    uint32_t num_open_blocks = 0;
+    uint32_t next_face = 0;
+    std::atomic<uint64_t> num_logged_ops(0);
+    float max_logged_edge = VOXELIZER_MAX_LOGGED_EDGE * voxel_size;
+
+    // The block of the large face being split into pieces, which are opened in front of it, and the sub-faces left to split
+    SplitBlock *large_face_block = nullptr;
+    std::vector<SubFace<Payload>> large_face_stack;
+
+    // Faces that cannot reach the grid's region are pruned straight away, whatever their size
+    auto isLargeFace = [&](uint32_t face_i) {
+        const Eigen::Vector3f face_vertices[3] = {vertices[faces[3 * face_i]], vertices[faces[3 * face_i + 1]], vertices[faces[3 * face_i + 2]]};
+        return std::max(std::max(euclideanDistance(face_vertices[0], face_vertices[1]), euclideanDistance(face_vertices[1], face_vertices[2])), euclideanDistance(face_vertices[2], face_vertices[0])) >= max_logged_edge
+               && voxel_grid.mayReachRegion(face_vertices);
+    };
+
+    auto openBlock = [&](SplitBlock *previous, uint32_t face_begin, uint32_t face_end) -> SplitBlock * {
+
+        std::unique_ptr<SplitBlock> block(new SplitBlock());
+        block->face_begin = face_begin;
+        block->face_end = face_end;
+        block->chunk.base_ref = vertices.size();
+        block->num_running = 1;
+        block->num_ops = 0;
+
+        std::unique_ptr<SplitBlock> &link = (previous != nullptr) ? previous->next : head;
+        if (tail == previous)
+            tail = block.get();
+        block->next = std::move(link);
+        link = std::move(block);
+        num_open_blocks++;
+        return link.get();
+    };
+
+    // Splits the large face depth-first, like splitFace, until a sub-face's split edge is short enough to log, and hands
+    // that sub-face out as a piece. The last piece takes over the face's block. Pieces are opened while the limits on
+    // open blocks and logged ops allow, and always once every piece before is replayed, so the face goes on.
+    auto splitLargeFace = [&](unsigned int &worker_i) {
+
+        if (large_face_block == nullptr)
+            return;
+
+        TRACE_SPAN("split_large_face");
+        uint64_t num_splits = 0;
+        int max_stack_size = 0;
+
+        while (large_face_block != nullptr && (head.get() == large_face_block || (num_open_blocks < max_open_blocks && num_logged_ops < max_logged_ops))) {
+
+            SubFace<Payload> sub_face = large_face_stack.back();
+            large_face_stack.pop_back();
+            int stack_size = large_face_stack.size();
+            max_stack_size = std::max(max_stack_size, stack_size);
+
+            int longest_i;
+            double longest_length;
+            if (stack_size < VOXELIZER_MAX_SPLIT_DEPTH && findSplitEdge(sub_face, longest_i, longest_length) && longest_length >= max_logged_edge) {
+
+                int a = longest_i, b = (longest_i + 1) % 3;
+                uint64_t selector = getMidpointSelector(sub_face, a, b);
+                Payload midpoint_payload = Traits::midpoint(sub_face.attributes[a], sub_face.attributes[b], selector);
+
+                SubFace<Payload> first_sub_face, second_sub_face;
+                splitAtMidpoint(voxel_grid, sub_face, longest_i, midpoint_payload, first_sub_face, second_sub_face);
+                bool first_reaches = voxel_grid.mayReachRegion(first_sub_face.vertices);
+                bool second_reaches = voxel_grid.mayReachRegion(second_sub_face.vertices);
+
+                // pruned sub-faces are dropped here, as splitFace would, but a sub-face is kept whole rather than
+                // leaving the face without a piece
+                if (first_reaches || second_reaches) {
+                    num_splits++;
+                    if (second_reaches)
+                        large_face_stack.push_back(second_sub_face);
+                    if (first_reaches)
+                        large_face_stack.push_back(first_sub_face);
+                    continue;
+                }
+            }
+
+            SplitBlock *block = large_face_block;
+            if (large_face_stack.empty()) {
+                large_face_block = nullptr;
+            } else {
+                SplitBlock *previous = nullptr;
+                for (SplitBlock *other = head.get(); other != large_face_block; other = other->next.get())
+                    previous = other;
+                block = openBlock(previous, large_face_block->face_begin, large_face_block->face_begin);
+            }
+
+            SplitTask task;
+            for (int i = 0; i < 3; i++) {
+                block->corner_payloads[i] = sub_face.attributes[i];
+                task.sub_face.vertices[i] = sub_face.vertices[i];
+                task.sub_face.voxel_ids[i] = sub_face.voxel_ids[i];
+                task.sub_face.attributes[i] = i;
+            }
+            block->piece = true;
+            block->started = true;
+            block->chunk.base_ref = 3;
+            task.chunk = &block->chunk;
+            task.block = block;
+            scheduler.push(worker_i++ % num_threads, task);
+        }
+
+        recordSplitStats(num_splits, 0, max_stack_size);
+    };
+
+    auto startBlocks = [&](unsigned int worker_i) {
+
+        while (num_open_blocks < max_open_blocks && next_face < num_faces) {
+            uint32_t face_end = std::min(num_faces, next_face + VOXELIZER_FACES_PER_TASK);
+            openBlock(tail, next_face, face_end);
+            next_face = face_end;
+        }
+
+        for (SplitBlock *block = head.get(); block != nullptr; block = block->next.get()) {
+
+            if (block->started)
+                continue;
+            if (block != head.get() && num_logged_ops >= max_logged_ops)
+                break;
+
+            if (isLargeFace(block->face_begin)) {
+
+                if (block != head.get())
+                    continue;
+
+                if (block->face_end > block->face_begin + 1)
+                    openBlock(block, block->face_begin + 1, block->face_end);
+                block->face_end = block->face_begin + 1;
+                block->started = true;
+                large_face_block = block;
+
+                SubFace<Payload> face;
+                for (int i = 0; i < 3; i++) {
+                    face.vertices[i] = vertices[faces[3 * block->face_begin + i]];
+                    face.voxel_ids[i] = vertex_voxel_ids[faces[3 * block->face_begin + i]];
+                    face.attributes[i] = vertex_payloads[faces[3 * block->face_begin + i]];
+                }
+                large_face_stack.assign(1, face);
+                continue;
+            }
+
+            SplitTask task;
+            task.face_begin = block->face_begin;
+            task.face_end = block->face_end;
+            task.chunk = &block->chunk;
+            task.block = block;
+            block->started = true;
+            scheduler.push(worker_i++ % num_threads, task);
+        }
+
+        splitLargeFace(worker_i);
+    };
+
+    auto finishBlock = [&](unsigned int worker_i, SplitBlock *block) {
+
+        TRACE_SPAN("finish_block");
+        std::lock_guard<std::mutex> lock(replay_mutex);
+        block->done = true;
+
+        while (head && head->done) {
+            TRACE_SPAN("replay");
+            replayChunk(voxel_grid, reducer, head->chunk, vertex_payloads, head->piece ? head->corner_payloads : nullptr);
+            num_logged_ops -= head->num_ops;
+            if (tail == head.get())
+                tail = nullptr;
+            head = std::move(head->next);
+            num_open_blocks--;
+        }
+
+        startBlocks(worker_i);
+    };
+
+    startBlocks(0);
+
+    scheduler.run([&](unsigned int worker_i, const SplitTask &task) {
+
+        auto countOps = [&](size_t num_ops) {
+            task.block->num_ops += num_ops;
+            num_logged_ops += num_ops;
+        };
+
+        if (task.face_begin == task.face_end) {
+
+            TRACE_SPAN("split_sub_face");
+            splitFaceIntoChunk(voxel_grid, task.sub_face, *task.chunk, task.block, scheduler, worker_i, min_stealable_edge);
+            countOps(task.chunk->ops.size());
+
+        } else {
+
+            TRACE_SPAN("split_faces");
+            for (uint32_t face_i = task.face_begin; face_i < task.face_end; face_i++) {
+
+                bool large_face = isLargeFace(face_i);
+
+                if (face_i > task.face_begin && (large_face || task.block->num_ops >= VOXELIZER_MAX_BLOCK_OPS || num_logged_ops >= max_logged_ops)) {
+                    std::lock_guard<std::mutex> lock(replay_mutex);
+                    openBlock(task.block, face_i, task.face_end);
+                    break;
+                }
+
+                SubFace<uint32_t> face;
+                for (int i = 0; i < 3; i++) {
+                    face.attributes[i] = faces[3 * face_i + i];
+                    face.vertices[i] = vertices[face.attributes[i]];
+                    face.voxel_ids[i] = vertex_voxel_ids[face.attributes[i]];
+                }
+
+                size_t num_ops = task.chunk->ops.size();
+                splitFaceIntoChunk(voxel_grid, face, *task.chunk, task.block, scheduler, worker_i, min_stealable_edge);
+                countOps(task.chunk->ops.size() - num_ops);
+            }
+        }
+
+        if (--task.block->num_running == 0)
+            finishBlock(worker_i, task.block);
+    });
+
+}
+
+// Same traversal as splitFace, but recording into a chunk.
+// While other workers are idle, second sub-faces with a long enough split edge are handed out as tasks of their own.
+template <typename Payload, typename Reducer, typename Storage>
+void Voxelizer<Payload, Reducer, Storage>::splitFaceIntoChunk(Grid &voxel_grid, const SubFace<uint32_t> &face, SplitChunk &chunk, SplitBlock *block, WorkStealingScheduler<SplitTask> &scheduler, unsigned int worker_i, float min_stealable_edge) {
+
+    SplitStackEntry stack[VOXELIZER_MAX_SPLIT_DEPTH + 2];
+    int stack_size = 0;
+    stack[stack_size++] = {face, -1};
+    uint64_t num_splits = 0, num_leaves = 0;
+    int max_stack_size = 0;
+
+    while (stack_size > 0) {
+
+        const SplitStackEntry entry = stack[--stack_size];
+        max_stack_size = std::max(max_stack_size, stack_size);
+
+        if (entry.child_i >= 0) {
+            chunk.push(SplitChunk::CHILD, entry.child_i, 0);
+            continue;
+        }
+
+        const SubFace<uint32_t> &sub_face = entry.face;
+        if (!voxel_grid.mayReachRegion(sub_face.vertices))
+            continue;
+
+        int longest_i;
+        double longest_length;
+        if (stack_size >= VOXELIZER_MAX_SPLIT_DEPTH || !findSplitEdge(sub_face, longest_i, longest_length)) {
+            for (int i = 0; i < 3; i++)
+                chunk.pushWrite(sub_face.attributes[i], sub_face.voxel_ids[i]);
+            num_leaves++;
+            continue;
+        }
+
+        if (chunk.base_ref + chunk.num_midpoints >= (1u << 30))
+            throw std::overflow_error("Voxelizer: too many midpoints in a single chunk");
+
+        uint32_t midpoint_ref = chunk.base_ref + chunk.num_midpoints++;
+        num_splits++;
+        int a = longest_i, b = (longest_i + 1) % 3;
+        uint64_t selector = getMidpointSelector(sub_face, a, b);
+        chunk.pushMidpoint(sub_face.attributes[a], sub_face.attributes[b], selector);
+
+        SubFace<uint32_t> first_sub_face, second_sub_face;
+        splitAtMidpoint(voxel_grid, sub_face, longest_i, midpoint_ref, first_sub_face, second_sub_face);
+
+        if (longest_length >= min_stealable_edge && scheduler.hasIdleWorkers()) {
+
+            std::unique_ptr<SplitChunk> child(new SplitChunk());
+            for (int i = 0; i < 3; i++) {
+                child->corner_refs[i] = second_sub_face.attributes[i];
+                second_sub_face.attributes[i] = i;
+            }
+            child->base_ref = 3;
+
+            SplitTask task;
+            task.sub_face = second_sub_face;
+            task.chunk = child.get();
+            task.block = block;
+            block->num_running++;
+
+            stack[stack_size++] = {SubFace<uint32_t>(), (int) chunk.children.size()};
+            chunk.children.push_back(std::move(child));
+            scheduler.push(worker_i, task);
+
+        } else {
+            stack[stack_size++] = {second_sub_face, -1};
+        }
+
+        stack[stack_size++] = {first_sub_face, -1};
+    }
+
+    recordSplitStats(num_splits, num_leaves, max_stack_size);
+}
+
+template <typename Payload, typename Reducer, typename Storage>
+void Voxelizer<Payload, Reducer, Storage>::replayChunk(Grid &voxel_grid, Reducer &reducer, const SplitChunk &chunk, const std::vector<Payload> &vertex_payloads, const Payload corner_payloads[3]) {
+
+    std::vector<Payload> midpoint_payloads(chunk.num_midpoints);
+    uint32_t num_midpoints = 0;
+
+    auto payload_of = [&](uint32_t ref) -> const Payload & {
+        if (ref >= chunk.base_ref)
+            return midpoint_payloads[ref - chunk.base_ref];
+        return (corner_payloads != nullptr) ? corner_payloads[ref] : vertex_payloads[ref];
+    };
+
+    for (size_t op_i = 0; op_i < chunk.ops.size(); op_i++) {
+
+        uint64_t op = chunk.ops[op_i];
+        uint32_t first = (op >> 32) & 0x3fffffff;
+        uint32_t second = op & 0xffffffff;
+
+        switch (op >> 62) {
+            case SplitChunk::WRITE:
+                reducer.write(voxel_grid, second, payload_of(first));
+                break;
+            case SplitChunk::WRITE_LONG:
+                reducer.write(voxel_grid, chunk.ops[++op_i], payload_of(first));
+                break;
+            case SplitChunk::MIDPOINT: {
+                uint64_t selector = Traits::MIDPOINT_USES_SELECTOR ? chunk.ops[++op_i] : 0;
+                midpoint_payloads[num_midpoints] = Traits::midpoint(payload_of(first), payload_of(second), selector);
+                num_midpoints++;
+                break;
+            }
+            case SplitChunk::CHILD: {
+                const SplitChunk &child = *chunk.children[first];
+                Payload child_corner_payloads[3];
+                for (int i = 0; i < 3; i++)
+                    child_corner_payloads[i] = payload_of(child.corner_refs[i]);
+                replayChunk(voxel_grid, reducer, child, vertex_payloads, child_corner_payloads);
+                break;
+            }
+        }
+    }
+}
+
+// Splits a face along its longest voxel-crossing edge until every sub-face lies within one voxel (or is too small),
+// then writes the payloads of the sub-face corners. Depth-first on a fixed-size stack, so the voxel writes happen
+// in the same order as the recursive formulation without storing any midpoint. Sub-faces that cannot reach the grid's
+// region are dropped, none of their writes would land in it.
+template <typename Payload, typename Reducer, typename Storage>
+void Voxelizer<Payload, Reducer, Storage>::splitFace(Grid &voxel_grid, Reducer &reducer, const SubFace<Payload> &face) {
+
+    SubFace<Payload> stack[VOXELIZER_MAX_SPLIT_DEPTH + 2];
+    int stack_size = 0;
+    stack[stack_size++] = face;
+    uint64_t num_splits = 0, num_leaves = 0;
+    int max_stack_size = 0;
+
+    while (stack_size > 0) {
+
+        const SubFace<Payload> sub_face = stack[--stack_size];
+        max_stack_size = std::max(max_stack_size, stack_size);
+        if (!voxel_grid.mayReachRegion(sub_face.vertices))
+            continue;
+
+        int longest_i;
+        double longest_length;
+        if (stack_size >= VOXELIZER_MAX_SPLIT_DEPTH || !findSplitEdge(sub_face, longest_i, longest_length)) {
+            for (int i = 0; i < 3; i++)
+                reducer.write(voxel_grid, sub_face.voxel_ids[i], sub_face.attributes[i]);
+            num_leaves++;
+            continue;
+        }
+
+        num_splits++;
+        int a = longest_i, b = (longest_i + 1) % 3;
+        uint64_t selector = getMidpointSelector(sub_face, a, b);
+        Payload midpoint_payload = Traits::midpoint(sub_face.attributes[a], sub_face.attributes[b], selector);
+
+        splitAtMidpoint(voxel_grid, sub_face, longest_i, midpoint_payload, stack[stack_size + 1], stack[stack_size]);
+        stack_size += 2;
+    }
+
+    recordSplitStats(num_splits, num_leaves, max_stack_size);
+}
+
+// The split loops count locally and record once per face, every leaf being three voxel writes
+template <typename Payload, typename Reducer, typename Storage>
+void Voxelizer<Payload, Reducer, Storage>::recordSplitStats(uint64_t num_splits, uint64_t num_leaves, int max_stack_size) {
+
+    STATS_ADD(SUB_FACES, 2 * num_splits);
+    STATS_ADD(MIDPOINTS, num_splits);
+    STATS_ADD(VOXEL_WRITES, 3 * num_leaves);
+    STATS_MAX(MAX_SPLIT_DEPTH, max_stack_size);
+}
+
+template <typename Payload, typename Reducer, typename Storage>
+void Voxelizer<Payload, Reducer, Storage>::recordGridStats(Grid &voxel_grid) {
+
+    STATS_ADD(OCCUPIED_VOXELS, voxel_grid.getNumOccupied());
+    voxel_grid.recordSetStats();
+}
+
+// Picks the selector that, together with the order of the endpoints a and b, decides a midpoint's payload. The
+// endpoints are ordered by position and the selector is a hash of the midpoint, so the payload depends on the midpoint
+// alone: not on the face order, nor on the faces split before it. Tiles and shards, which only split some of the faces
+// and prune their sub-faces, thus get the payloads of a single pass.
+template <typename Payload, typename Reducer, typename Storage>
+template <typename Attribute>
+uint64_t Voxelizer<Payload, Reducer, Storage>::getMidpointSelector(const SubFace<Attribute> &face, int &a, int &b) {
+
+    if (!Traits::MIDPOINT_USES_SELECTOR)
+        return 0;
+
+    const Eigen::Vector3f &vertex_a = face.vertices[a], &vertex_b = face.vertices[b];
+    if (std::lexicographical_compare(vertex_b.data(), vertex_b.data() + 3, vertex_a.data(), vertex_a.data() + 3))
+        std::swap(a, b);
+
+    Eigen::Vector3f midpoint = getMidpoint(face.vertices[a], face.vertices[b]);
+    uint32_t bits[3];
+    std::memcpy(bits, midpoint.data(), sizeof(bits));
+
+    uint64_t hash = (bits[0] * 0x9E3779B97F4A7C15ull) ^ (bits[1] * 0xC2B2AE3D27D4EB4Full) ^ (bits[2] * 0x165667B19E3779F9ull);
+    hash ^= hash >> 29;
+    hash *= 0xBF58476D1CE4E5B9ull;
+    return hash ^ (hash >> 32);
+}
+
+// Returns false if the face is not split any further, otherwise the longest of its voxel-crossing edges
+template <typename Payload, typename Reducer, typename Storage>
+template <typename Attribute>
+bool Voxelizer<Payload, Reducer, Storage>::findSplitEdge(const SubFace<Attribute> &face, int &longest_i, double &longest_length) {
+
+    if (areaOfTriangle(face.vertices[0], face.vertices[1], face.vertices[2]) < VOXELIZER_MIN_TRIANGLE_AREA)
+        return false;
+
+    double side_lengths[3] = {0, 0, 0};
+    bool single_voxel_triangle = true;
+    for (int i = 0; i < 3; i++) {
+        if (face.voxel_ids[i] != face.voxel_ids[(i + 1) % 3]) {
+            side_lengths[i] = euclideanDistance(face.vertices[i], face.vertices[(i + 1) % 3]);
+            single_voxel_triangle = false;
+        }
+    }
+
+    if (single_voxel_triangle)
+        return false;
+
+    longest_i = 0;
+    longest_length = 0;
+    for (int i = 0; i < 3; i++) {
+        if (side_lengths[i] > longest_length) {
+            longest_length = side_lengths[i];
+            longest_i = i;
+        }
+    }
+
+    return true;
+}
+
+// Halves the face at the midpoint of edge longest_i. The first sub-face keeps the edge's first vertex, the second its second one.
+template <typename Payload, typename Reducer, typename Storage>
+template <typename Attribute, typename Indexer>
+void Voxelizer<Payload, Reducer, Storage>::splitAtMidpoint(Indexer &indexer, const SubFace<Attribute> &face, int longest_i, Attribute midpoint_attribute, SubFace<Attribute> &first_sub_face, SubFace<Attribute> &second_sub_face) {
+
+    int a = longest_i, b = (longest_i + 1) % 3, c = (longest_i + 2) % 3;
+
+    Eigen::Vector3f midpoint = getMidpoint(face.vertices[a], face.vertices[b]);
+    int64_t midpoint_voxel_id = indexer.getEnclosingVoxelID(midpoint);
+
+    first_sub_face = {{face.vertices[a], face.vertices[c], midpoint}, {face.voxel_ids[a], face.voxel_ids[c], midpoint_voxel_id}, {face.attributes[a], face.attributes[c], midpoint_attribute}};
+    second_sub_face = {{face.vertices[b], face.vertices[c], midpoint}, {face.voxel_ids[b], face.voxel_ids[c], midpoint_voxel_id}, {face.attributes[b], face.attributes[c], midpoint_attribute}};
+}
+
+template <typename Payload, typename Reducer, typename Storage>
+float Voxelizer<Payload, Reducer, Storage>::areaOfTriangle(Eigen::Vector3f vertex_1, Eigen::Vector3f vertex_2, Eigen::Vector3f vertex_3) {
+
+    return (vertex_2 - vertex_1).cross(vertex_3 - vertex_1).norm() / 2.0;
+
+}
+
+template <typename Payload, typename Reducer, typename Storage>
+Eigen::Vector3f Voxelizer<Payload, Reducer, Storage>::getMidpoint(Eigen::Vector3f v1, Eigen::Vector3f v2) {
+
+    return (v1 + v2) / 2;
+}
+
+template <typename Payload, typename Reducer, typename Storage>
+float Voxelizer<Payload, Reducer, Storage>::euclideanDistance(Eigen::Vector3f v1, Eigen::Vector3f v2) {
+    return std::sqrt(std::pow((v1[0] - v2[0]),2) + std::pow((v1[1] - v2[1]),2) + std::pow((v1[2] - v2[2]),2));
+}
+
+#endif /* defined(__VOXELIZER__) */
@@ -0,0 +1,201 @@
+/*
+ Classy Voxelizer
+
+ BSD 2-Clause License
+ Copyright (c) 2018, Dario Rethage
+ See LICENSE at package root for full license
+ */
+
+#ifndef __WORKSTEALINGSCHEDULER__
+#define __WORKSTEALINGSCHEDULER__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <exception>
+
+#include "Trace.h"
+
+// Runs tasks of type Task on a fixed set of worker threads. Every worker owns a deque:
+// it pushes and pops at the back, idle workers steal from the front of the others,
+// which hands out the oldest (and typically largest) pending work first.
+template <typename Task>
+class WorkStealingScheduler {
+public:
+    WorkStealingScheduler(unsigned int num_workers);
+
+    // Queues a task on a worker's deque. May be called from inside a running task.
+    void push(unsigned int worker_i, const Task &task);
+
+    // True while some worker is out of work and looking for something to steal.
+    bool hasIdleWorkers() const;
+
+    unsigned int getNumWorkers() const;
+
+    // Runs all queued tasks, and every task they push, to completion.
+    // func(worker_i, task) is called concurrently; the first exception thrown is rethrown here.
+    template <typename Func>
+    void run(Func func);
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    bool pop(unsigned int worker_i, Task &task);
+    bool steal(unsigned int worker_i, Task &task);
+
+    std::vector<std::unique_ptr<Queue>> _queues;
+    std::atomic<size_t> _num_pending;
+    std::atomic<unsigned int> _num_idle;
+};
+
+// Returns num_threads, or the number of hardware threads if num_threads is 0.
+inline unsigned int resolveNumThreads(unsigned int num_threads) {
+
+    if (num_threads > 0)
+        return num_threads;
+
+    unsigned int hardware_threads = std::thread::hardware_concurrency();
+    return (hardware_threads > 0) ? hardware_threads : 1;
+}
+
+template <typename Task>
+WorkStealingScheduler<Task>::WorkStealingScheduler(unsigned int num_workers) : _num_pending(0), _num_idle(0) {
+
+    if (num_workers == 0)
+        num_workers = 1;
+
+    for (unsigned int i = 0; i < num_workers; i++)
+        _queues.emplace_back(new Queue());
+}
+
+template <typename Task>
+void WorkStealingScheduler<Task>::push(unsigned int worker_i, const Task &task) {
+
+    _num_pending++;
+
+    Queue &queue = *_queues[worker_i % _queues.size()];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.tasks.push_back(task);
+}
+
+template <typename Task>
+bool WorkStealingScheduler<Task>::hasIdleWorkers() const {
+    return _num_idle.load(std::memory_order_relaxed) > 0;
+}
+
+template <typename Task>
+unsigned int WorkStealingScheduler<Task>::getNumWorkers() const {
+    return _queues.size();
+}
+
+template <typename Task>
+bool WorkStealingScheduler<Task>::pop(unsigned int worker_i, Task &task) {
+
+    Queue &queue = *_queues[worker_i];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+
+    if (queue.tasks.empty())
+        return false;
+
+    task = queue.tasks.back();
+    queue.tasks.pop_back();
+    return true;
+}
+
+template <typename Task>
+bool WorkStealingScheduler<Task>::steal(unsigned int worker_i, Task &task) {
+
+    for (size_t offset = 1; offset < _queues.size(); offset++) {
+
+        Queue &queue = *_queues[(worker_i + offset) % _queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+
+        if (queue.tasks.empty())
+            continue;
+
+        task = queue.tasks.front();
+        queue.tasks.pop_front();
+        return true;
+    }
+
+    return false;
+}
+
+template <typename Task>
+template <typename Func>
+void WorkStealingScheduler<Task>::run(Func func) {
+
+    std::exception_ptr first_exception;
+    std::mutex exception_mutex;
+    std::atomic<bool> failed(false);
+
+    auto worker = [&](unsigned int worker_i) {
+
+        // worker 0 is the calling thread
+        if (worker_i > 0)
+            TRACE_THREAD_NAME("worker");
+
+        Task task;
+        bool idle = false;
+
+        while (_num_pending.load() > 0 && !failed.load()) {
+
+            if (pop(worker_i, task) || steal(worker_i, task)) {
+
+                if (idle) {
+                    _num_idle--;
+                    idle = false;
+                }
+
+                try {
+                    func(worker_i, task);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(exception_mutex);
+                    if (!first_exception)
+                        first_exception = std::current_exception();
+                    failed = true;
+                }
+
+                _num_pending--;
+
+            } else {
+
+                if (!idle) {
+                    _num_idle++;
+                    idle = true;
+                }
+
+                std::this_thread::yield();
+            }
+        }
+
+        if (idle)
+            _num_idle--;
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned int i = 1; i < _queues.size(); i++)
+        threads.emplace_back(worker, i);
+
+    worker(0);
+
+    for (auto &thread : threads)
+        thread.join();
+
+    for (auto &queue : _queues)
+        queue->tasks.clear();
+    _num_pending = 0;
+
+    if (first_exception)
+        std::rethrow_exception(first_exception);
+}
+
+#endif /* defined(__WORKSTEALINGSCHEDULER__) */
@@ -42,14 +42,6 @@ namespace tinyply
 	inline float endian_swap_float(const uint32_t & v) { union {float f; uint32_t i;}; i = endian_swap(v); return f; }
 	inline double endian_swap_double(const uint64_t & v) { union {double d; uint64_t i;}; i = endian_swap(v); return d; }
 
-	struct DataCursor
-	{
-		void * vector;
-		uint8_t * data;
-		size_t offset;
-		bool realloc = false;
-	};
-
 	class PlyProperty
 	{
 		void parse_internal(std::istream & is);
@@ -78,6 +70,16 @@ namespace tinyply
 		int listCount = 0;
 	};
 
+	struct DataCursor
+	{
+		void * vector;
+		uint8_t * data;
+		size_t offset;
+		bool realloc = false;
+		size_t stride = 0; // bytes from one instance to the next for raw destinations, 0 when packed into a vector
+		PlyProperty::Type type = PlyProperty::Type::INVALID; // value type of raw destinations, values of other types are converted to it
+	};
+
 	inline std::string make_key(const std::string & a, const std::string & b)
 	{
 		return (a + "-" + b);
@@ -166,6 +168,20 @@ namespace tinyply
 		}
 	}
 
+	template <typename T>
+	inline PlyProperty::Type property_type_of()
+	{
+		if (std::is_same<T, int8_t>::value)          return PlyProperty::Type::INT8;
+		else if (std::is_same<T, uint8_t>::value)    return PlyProperty::Type::UINT8;
+		else if (std::is_same<T, int16_t>::value)    return PlyProperty::Type::INT16;
+		else if (std::is_same<T, uint16_t>::value)   return PlyProperty::Type::UINT16;
+		else if (std::is_same<T, int32_t>::value)    return PlyProperty::Type::INT32;
+		else if (std::is_same<T, uint32_t>::value)   return PlyProperty::Type::UINT32;
+		else if (std::is_same<T, float>::value)      return PlyProperty::Type::FLOAT32;
+		else if (std::is_same<T, double>::value)     return PlyProperty::Type::FLOAT64;
+		else return PlyProperty::Type::INVALID;
+	}
+
 	template <typename T>
 	inline PlyProperty::Type property_type_for_type(std::vector<T> & theType)
 	{
@@ -211,7 +227,15 @@ namespace tinyply
 		PlyFile() {}
 		PlyFile(std::istream & is);
 
+		// Binary elements are decoded in chunks of records, lists of constant length included; requested lists must
+		// keep the length of their first record.
 		void read(std::istream & is);
+
+		// Same as read(is), with is left after the header. Binary little-endian files whose elements have a fixed
+		// record size (lists of constant length) are memory-mapped from filepath and copied record by record with
+		// strided copies. ASCII files with one record per line and lists of constant length are memory-mapped and
+		// parsed in parallel line ranges. Anything else, and files with elements read in chunks, fall back to read(is).
+		void read(std::istream & is, const std::string & filepath);
 		void write(std::ostream & os, bool isBinary);
 
 		std::vector<PlyElement> & get_elements() { return elements; }
@@ -219,6 +243,21 @@ namespace tinyply
 		std::vector<std::string> comments;
 		std::vector<std::string> objInfo;
 
+		// Calls onDecoded(begin, end) once the requested properties of the element's instances [begin, end) are decoded,
+		// range after range, while the rest of the file is still being read. Ranges are disjoint but may be handed over
+		// on several threads at once.
+		void request_decoded_ranges(const std::string & elementKey, std::function<void(size_t, size_t)> onDecoded)
+		{
+			decodedRequests[elementKey] = onDecoded;
+		}
+
+		// Decodes the instances of an element chunkRecords at a time: destinations requested after this call hold one
+		// chunk, which read hands to onChunk(records) before decoding the next one over it
+		void request_chunks(const std::string & elementKey, size_t chunkRecords, std::function<void(size_t)> onChunk)
+		{
+			chunkRequests[elementKey] = { std::max<size_t>(chunkRecords, 1), onChunk };
+		}
+
 		template<typename T>
 		size_t request_properties_from_element(const std::string & elementKey, std::vector<std::string> propertyKeys, std::vector<T> & source, const int listCount = 1)
 		{
@@ -244,7 +283,7 @@ namespace tinyply
 						{
 							if (PropertyTable[property_type_for_type(source)].stride != PropertyTable[p.propertyType].stride)
 								throw std::runtime_error("destination vector is wrongly typed to hold this property");
-							return e.size;
+							return records_held(e);
 
 						}
 					}
@@ -312,6 +351,52 @@ namespace tinyply
 			return totalInstanceSize / propertyKeys.size();
 		}
 
+		// Decodes the properties of every instance straight into caller-owned memory: instance i goes to
+		// destination + i * instanceStride bytes, so e.g. x, y, z can land in an array of 3D vectors.
+		// Only for scalar properties; destination must hold the element's size() instances, or a chunk of them.
+		// Values of another type than T are converted to T, integers wrapping like a static_cast.
+		template<typename T>
+		size_t request_properties_from_element(const std::string & elementKey, const std::vector<std::string> & propertyKeys, T * destination, size_t numInstances, size_t instanceStride)
+		{
+			int elementIndex = find_element(elementKey, get_elements());
+			if (elementIndex < 0) return 0;
+
+			const PlyElement & element = get_elements()[elementIndex];
+			if (records_held(element) > numInstances)
+				throw std::invalid_argument("destination is too small for element: " + elementKey);
+
+			auto cursor = std::make_shared<DataCursor>();
+			cursor->vector = nullptr;
+			cursor->data = reinterpret_cast<uint8_t *>(destination);
+			cursor->offset = 0;
+			cursor->stride = instanceStride;
+			cursor->type = property_type_of<T>();
+			if (cursor->type == PlyProperty::Type::INVALID)
+				throw std::invalid_argument("destination type is no ply property type");
+
+			size_t numFound = 0;
+			for (const auto & key : propertyKeys)
+			{
+				for (const auto & p : element.properties)
+				{
+					if (p.name != key) continue;
+					if (p.isList)
+						throw std::runtime_error("destination is wrongly typed to hold this property");
+					if (userDataTable.insert(std::make_pair(make_key(elementKey, key), cursor)).second == false)
+						throw std::invalid_argument("property has already been requested: " + key);
+					numFound++;
+				}
+			}
+			if (numFound == 0) return 0;
+			if (numFound * sizeof(T) > instanceStride)
+				throw std::invalid_argument("instance stride is too small for the requested properties");
+
+			if (std::find(requestedElements.begin(), requestedElements.end(), elementKey) == requestedElements.end())
+				requestedElements.push_back(elementKey);
+
+			return records_held(element);
+		}
+
 		template<typename T>
 		void add_properties_to_element(const std::string & elementKey, const std::vector<std::string> & propertyKeys, std::vector<T> & source, const int listCount = 1, const PlyProperty::Type listType = PlyProperty::Type::INVALID)
 		{
@@ -347,11 +432,19 @@ namespace tinyply
 
 	private:
 
-		size_t skip_property_binary(const PlyProperty & property, std::istream & is);
-		void skip_property_ascii(const PlyProperty & property, std::istream & is);
+		struct ChunkRequest
+		{
+			size_t records;
+			std::function<void(size_t)> onChunk;
+		};
+
+		// Instances of an element a destination holds at once
+		size_t records_held(const PlyElement & element) const
+		{
+			auto chunk = chunkRequests.find(element.name);
+			return chunk == chunkRequests.end() ? element.size : std::min(element.size, chunk->second.records);
+		}
 
-		void read_property_binary(PlyProperty::Type t, void * dest, size_t & destOffset, std::istream & is);
-		void read_property_ascii(PlyProperty::Type t, void * dest, size_t & destOffset, std::istream & is);
 		void write_property_ascii(PlyProperty::Type t, std::ostream & os, uint8_t * src, size_t & srcOffset);
 		void write_property_binary(PlyProperty::Type t, std::ostream & os, uint8_t * src, size_t & srcOffset);
 
@@ -364,6 +457,8 @@ namespace tinyply
 		void read_header_text(std::string line, std::istream & is, std::vector<std::string> & place, int erase = 0);
 
 		void read_internal(std::istream & is);
+		bool read_mapped(const uint8_t * data, size_t dataSize);
+		bool read_mapped_ascii(const char * data, size_t dataSize);
 
 		void write_ascii_internal(std::ostream & os);
 		void write_binary_internal(std::ostream & os);
@@ -375,6 +470,8 @@ namespace tinyply
 
 		std::vector<PlyElement> elements;
 		std::vector<std::string> requestedElements;
+		std::map<std::string, ChunkRequest> chunkRequests;
+		std::map<std::string, std::function<void(size_t, size_t)>> decodedRequests;
 	};
 
 } // namesapce tinyply
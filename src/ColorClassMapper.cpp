@@ -0,0 +1,113 @@
+/*
+ Classy Voxelizer
+
+ BSD 2-Clause License
+ Copyright (c) 2018, Dario Rethage
+ See LICENSE at package root for full license
+ */
+
+#include "ColorClassMapper.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <memory>
+#include <thread>
+#include <algorithm>
+#include <functional>
+
+#include "OccupancyBitmap.h"
+#include "WorkStealingScheduler.h"
+
+bool ColorClassMapper::loadPalette(const std::string &filepath, std::vector<Eigen::Vector3i> &colormap) {
+
+    std::ifstream palette_file(filepath);
+    if (!palette_file) {
+        std::cerr << "Error: could not open palette " << filepath << std::endl;
+        return false;
+    }
+
+    std::string line;
+    int line_i = 0;
+    while (std::getline(palette_file, line)) {
+
+        line_i++;
+        std::istringstream fields(line);
+        std::string first;
+        if (!(fields >> first) || first[0] == '#')
+            continue;
+
+        std::istringstream color_fields(line);
+        Eigen::Vector3i color;
+        if (!(color_fields >> color[0] >> color[1] >> color[2]) || color.minCoeff() < 0 || color.maxCoeff() > 255) {
+            std::cerr << "Error: palette line " << line_i << " is not a \"red green blue\" color" << std::endl;
+            return false;
+        }
+
+        colormap.push_back(color);
+    }
+
+    if (colormap.size() > 255) {
+        std::cerr << "Error: ClassyVoxelizer only supports mapping up to 255 colors to classes." << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+// Every thread collects the new colors of its range in first-seen order, the ranges are then merged in order,
+// which numbers the new classes exactly as a serial scan would. The table is read-only while threads run.
+bool ColorClassMapper::mapColors(const PackedColor *colors, size_t num_colors, std::vector<Eigen::Vector3i> &colormap, uint8_t *classes, unsigned int num_threads) {
+
+    std::unique_ptr<uint8_t[]> class_table(new uint8_t[1 << 24]());
+
+    for (size_t class_i = colormap.size(); class_i > 0; class_i--)
+        class_table[pack(colormap[class_i - 1])] = class_i;
+
+    size_t num_ranges = std::max<size_t>(1, std::min<size_t>(resolveNumThreads(num_threads), num_colors / COLORCLASSMAPPER_MIN_COLORS_PER_THREAD));
+    size_t range_size = (num_colors + num_ranges - 1) / num_ranges;
+
+    auto forEachRange = [&](std::function<void(size_t, size_t, size_t)> func) {
+        std::vector<std::thread> threads;
+        for (size_t range_i = 1; range_i < num_ranges; range_i++)
+            threads.emplace_back(func, range_i, range_i * range_size, std::min(num_colors, (range_i + 1) * range_size));
+        func(0, 0, std::min(num_colors, range_size));
+        for (auto &thread : threads)
+            thread.join();
+    };
+
+    std::vector<std::vector<uint32_t>> new_colors(num_ranges);
+    forEachRange([&](size_t range_i, size_t begin, size_t end) {
+        OccupancyBitmap seen((uint64_t) 1 << 24);
+        for (size_t color_i = begin; color_i < end; color_i++) {
+            uint32_t key = pack(colors[color_i]);
+            if (class_table[key] == 0 && !seen.test(key)) {
+                seen.set(key);
+                new_colors[range_i].push_back(key);
+            }
+        }
+    });
+
+    for (const auto &range_colors : new_colors) {
+        for (uint32_t key : range_colors) {
+
+            if (class_table[key] != 0)
+                continue;
+
+            if (colormap.size() == 255) {
+                std::cerr << "Error: ClassyVoxelizer only supports mapping up to 255 colors to classes." << std::endl;
+                return false;
+            }
+
+            colormap.push_back(Eigen::Vector3i(key & 255, (key >> 8) & 255, key >> 16));
+            class_table[key] = colormap.size();
+        }
+    }
+
+    forEachRange([&](size_t range_i, size_t begin, size_t end) {
+        for (size_t color_i = begin; color_i < end; color_i++)
+            classes[color_i] = class_table[pack(colors[color_i])];
+    });
+
+    return true;
+}
@@ -0,0 +1,169 @@
+/*
+ Classy Voxelizer
+
+ BSD 2-Clause License
+ Copyright (c) 2018, Dario Rethage
+ See LICENSE at package root for full license
+ */
+
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <mutex>
+
+#include "tinyply.h"
+#include "ColorClassMapper.h"
+#include "MeshReader.h"
+#include "Stats.h"
+#include "Trace.h"
+
+// Number of instances the header declares for an element, 0 if it is missing
+static size_t getElementSize(tinyply::PlyFile &input_file, const std::string &element_key) {
+
+    for (const auto &element : input_file.get_elements()) {
+        if (element.name == element_key)
+            return element.size;
+    }
+
+    return 0;
+}
+
+// Vertex positions are decoded straight into the final array, no intermediate buffer, and bounded by min and max
+// range by range as they are decoded
+static void requestVertices(tinyply::PlyFile &input_file, std::vector<Eigen::Vector3f> &vertices, Eigen::Vector3f &min, Eigen::Vector3f &max) {
+
+    vertices.resize(getElementSize(input_file, "vertex"));
+    input_file.request_properties_from_element("vertex", { "x", "y", "z" }, reinterpret_cast<float *>(vertices.data()), vertices.size(), sizeof(Eigen::Vector3f));
+
+    min = Eigen::Vector3f::Constant(std::numeric_limits<float>::max());
+    max = Eigen::Vector3f::Constant(std::numeric_limits<float>::lowest());
+
+    std::shared_ptr<std::mutex> bounds_mutex = std::make_shared<std::mutex>();
+    input_file.request_decoded_ranges("vertex", [&vertices, &min, &max, bounds_mutex](size_t begin, size_t end) {
+        Eigen::Vector3f range_min = Eigen::Vector3f::Constant(std::numeric_limits<float>::max());
+        Eigen::Vector3f range_max = Eigen::Vector3f::Constant(std::numeric_limits<float>::lowest());
+        for (size_t i = begin; i < end; ++i) {
+            range_min = range_min.cwiseMin(vertices[i]);
+            range_max = range_max.cwiseMax(vertices[i]);
+        }
+
+        std::lock_guard<std::mutex> lock(*bounds_mutex);
+        min = min.cwiseMin(range_min);
+        max = max.cwiseMax(range_max);
+    });
+}
+
+// Faces as three vertex indices each, unless faces is null
+static void requestFaces(tinyply::PlyFile &input_file, std::vector<uint32_t> *faces) {
+
+    if (faces)
+        input_file.request_properties_from_element("face", { "vertex_indices" }, *faces, 3);
+}
+
+// Decodes the requested properties, the bulk of reading a mesh
+static void readRequested(tinyply::PlyFile &input_file, std::istream &ss, const std::string &filepath) {
+
+    TRACE_SPAN("ply_read");
+    input_file.read(ss, filepath);
+}
+
+// Labels are decoded straight into the class array, converted from whatever integer type the file stores them as;
+// they start at 0 for meshes without labels
+bool readPlyWithLabelProperties(std::string filepath, std::vector<Eigen::Vector3f> &vertices, Eigen::Vector3f &min, Eigen::Vector3f &max, std::vector<uint32_t> *faces, std::vector<uint8_t> &classes, std::vector<Eigen::Vector3i> &colormap) {
+
+    STATS_PHASE("read");
+    TRACE_SPAN_DETAIL("read", filepath);
+
+    std::ifstream ss(filepath, std::ios::binary);
+
+    tinyply::PlyFile input_file(ss);
+
+    requestVertices(input_file, vertices, min, max);
+    classes.assign(vertices.size(), 0);
+    input_file.request_properties_from_element("vertex", { "label" }, classes.data(), classes.size(), sizeof(uint8_t));
+    requestFaces(input_file, faces);
+
+    readRequested(input_file, ss, filepath);
+
+    return true;
+
+}
+
+// colormap may come with a palette, whose colors keep their classes
+bool readPlyWithClass(std::string filepath, std::vector<Eigen::Vector3f> &vertices, Eigen::Vector3f &min, Eigen::Vector3f &max, std::vector<uint32_t> *faces, std::vector<uint8_t> &classes, std::vector<Eigen::Vector3i> &colormap, unsigned int num_threads) {
+
+    STATS_PHASE("read");
+    TRACE_SPAN_DETAIL("read", filepath);
+
+    std::ifstream ss(filepath, std::ios::binary);
+
+    tinyply::PlyFile input_file(ss);
+
+    requestVertices(input_file, vertices, min, max);
+    std::vector<PackedColor> colors(vertices.size(), PackedColor(0, 0, 0));
+    input_file.request_properties_from_element("vertex", { "red", "green", "blue" }, colors.data()->rgba, colors.size(), sizeof(PackedColor));
+    requestFaces(input_file, faces);
+
+    readRequested(input_file, ss, filepath);
+
+    TRACE_SPAN("map_colors");
+    classes.resize(vertices.size());
+
+    return ColorClassMapper::mapColors(colors.data(), colors.size(), colormap, classes.data(), num_threads);
+
+}
+
+// Colors are decoded straight into the payload array; they start opaque black for meshes without colors
+bool readPlyWithColor(std::string filepath, std::vector<Eigen::Vector3f> &vertices, Eigen::Vector3f &min, Eigen::Vector3f &max, std::vector<uint32_t> *faces, std::vector<PackedColor> &colors) {
+
+    STATS_PHASE("read");
+    TRACE_SPAN_DETAIL("read", filepath);
+
+    std::ifstream ss(filepath, std::ios::binary);
+
+    tinyply::PlyFile input_file(ss);
+
+    requestVertices(input_file, vertices, min, max);
+    colors.assign(vertices.size(), PackedColor(0, 0, 0));
+    input_file.request_properties_from_element("vertex", { "red", "green", "blue" }, colors.data()->rgba, colors.size(), sizeof(PackedColor));
+    requestFaces(input_file, faces);
+
+    readRequested(input_file, ss, filepath);
+
+    return true;
+
+}
+
+// The face element is decoded into one buffer of faces_per_chunk faces, handed over chunk by chunk; the vertex
+// element is skipped
+bool readPlyFaces(std::string filepath, size_t faces_per_chunk, const std::function<void(const std::vector<uint32_t> &faces)> &on_faces) {
+
+    TRACE_SPAN_DETAIL("read_faces", filepath);
+
+    std::ifstream ss(filepath, std::ios::binary);
+    if (!ss)
+        return false;
+
+    tinyply::PlyFile input_file(ss);
+
+    std::vector<uint32_t> faces;
+    input_file.request_chunks("face", faces_per_chunk, [&](size_t num_faces) {
+        if (3 * num_faces < faces.size())
+            faces.resize(3 * num_faces);
+        on_faces(faces);
+    });
+    requestFaces(input_file, &faces);
+
+    readRequested(input_file, ss, filepath);
+
+    return true;
+
+}
+
+// Pads the bounding box a reader computed by one voxel on each side
+void getVoxelSpaceDimensions(const double voxel_size, Eigen::Vector3f &min, Eigen::Vector3f &max) {
+
+    max += Eigen::Vector3f(voxel_size, voxel_size, voxel_size);
+    min -= Eigen::Vector3f(voxel_size, voxel_size, voxel_size);
+
+}
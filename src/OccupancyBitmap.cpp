@@ -0,0 +1,58 @@
+/*
+ Classy Voxelizer
+
+ BSD 2-Clause License
+ Copyright (c) 2018, Dario Rethage
+ See LICENSE at package root for full license
+ */
+
+#include "OccupancyBitmap.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define OCCUPANCYBITMAP_X86_64
+#endif
+
+OccupancyBitmap::OccupancyBitmap(uint64_t num_voxels) {
+
+    uint64_t page_voxels = PAGE_WORDS << 6;
+    _pages.resize((num_voxels + page_voxels - 1) / page_voxels);
+
+}
+
+uint64_t OccupancyBitmap::count() const {
+
+#ifdef OCCUPANCYBITMAP_X86_64
+    bool has_popcnt = __builtin_cpu_supports("popcnt");
+#else
+    bool has_popcnt = false;
+#endif
+
+    uint64_t num_set = 0;
+    for (const std::unique_ptr<uint64_t[]> &page : _pages) {
+        if (page)
+            num_set += has_popcnt ? countPOPCNT(page.get(), PAGE_WORDS) : countScalar(page.get(), PAGE_WORDS);
+    }
+
+    return num_set;
+}
+
+uint64_t OccupancyBitmap::countScalar(const uint64_t *words, uint64_t num_words) {
+
+    uint64_t num_set = 0;
+    for (uint64_t word_i = 0; word_i < num_words; word_i++)
+        num_set += __builtin_popcountll(words[word_i]);
+
+    return num_set;
+}
+
+#ifdef OCCUPANCYBITMAP_X86_64
+__attribute__((target("popcnt")))
+#endif
+uint64_t OccupancyBitmap::countPOPCNT(const uint64_t *words, uint64_t num_words) {
+
+    uint64_t num_set = 0;
+    for (uint64_t word_i = 0; word_i < num_words; word_i++)
+        num_set += __builtin_popcountll(words[word_i]);
+
+    return num_set;
+}
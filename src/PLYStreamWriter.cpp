@@ -0,0 +1,121 @@
+/*
+ Classy Voxelizer
+
+ BSD 2-Clause License
+ Copyright (c) 2018, Dario Rethage
+ See LICENSE at package root for full license
+ */
+
+#include <stdexcept>
+#include <sstream>
+
+#include "PLYStreamWriter.h"
+#include "Stats.h"
+#include "Trace.h"
+
+PLYStreamWriter::PLYStreamWriter(const std::string &filepath, const std::string &element_name, uint64_t num_records, const std::vector<std::string> &properties) :
+    _file(filepath, std::ios::out | std::ios::binary), _buffer(new char[PLYSTREAMWRITER_BUFFER_SIZE]), _buffer_used(0), _filepath(filepath) {
+
+    if (!_file)
+        throw std::runtime_error("PLYStreamWriter: could not open " + filepath);
+
+    _file << "ply\n" << "format binary_little_endian 1.0\n" << "element " << element_name << " " << num_records << "\n";
+    for (const std::string &property : properties)
+        _file << "property " << property << "\n";
+    _file << "end_header\n";
+    STATS_ADD(BYTES_WRITTEN, _file.tellp());
+
+}
+
+PLYStreamWriter::~PLYStreamWriter() {
+
+    if (_file.is_open()) {
+        flush();
+        _file.close();
+    }
+
+}
+
+void PLYStreamWriter::flush() {
+
+    TRACE_SPAN("ply_flush");
+    _file.write(_buffer.get(), _buffer_used);
+    STATS_ADD(BYTES_WRITTEN, _buffer_used);
+    _buffer_used = 0;
+}
+
+void PLYStreamWriter::close() {
+
+    flush();
+    _file.close();
+
+    if (!_file)
+        throw std::runtime_error("PLYStreamWriter: could not write " + _filepath);
+}
+
+// Headers are "element <name> <count>" and "property ..." lines between the format line and end_header
+void PLYStreamWriter::concatenate(const std::vector<std::string> &input_filepaths, const std::string &filepath) {
+
+    STATS_PHASE("concatenate");
+    TRACE_SPAN_DETAIL("concatenate", filepath);
+
+    struct Input {
+        std::streamoff header_size;
+        std::string element_name;
+        uint64_t num_records;
+        std::vector<std::string> properties;
+    };
+
+    std::vector<Input> inputs;
+    uint64_t num_records = 0;
+
+    for (const std::string &input_filepath : input_filepaths) {
+
+        std::ifstream input_file(input_filepath, std::ios::binary);
+        Input input = {0, "", 0, {}};
+        std::string line;
+
+        while (std::getline(input_file, line) && line != "end_header") {
+            std::istringstream fields(line);
+            std::string keyword;
+            fields >> keyword;
+            if (keyword == "element")
+                fields >> input.element_name >> input.num_records;
+            else if (keyword == "property")
+                input.properties.push_back(line.substr(9));
+        }
+
+        if (!input_file)
+            throw std::runtime_error("PLYStreamWriter: could not read " + input_filepath);
+
+        input.header_size = input_file.tellg();
+
+        if (!inputs.empty() && (input.element_name != inputs[0].element_name || input.properties != inputs[0].properties))
+            throw std::runtime_error("PLYStreamWriter: " + input_filepath + " does not match " + input_filepaths[0]);
+
+        num_records += input.num_records;
+        inputs.push_back(std::move(input));
+    }
+
+    if (inputs.empty())
+        throw std::runtime_error("PLYStreamWriter: nothing to concatenate into " + filepath);
+
+    PLYStreamWriter output_file(filepath, inputs[0].element_name, num_records, inputs[0].properties);
+
+    for (size_t input_i = 0; input_i < inputs.size(); input_i++) {
+
+        std::ifstream input_file(input_filepaths[input_i], std::ios::binary);
+        input_file.seekg(inputs[input_i].header_size);
+
+        while (input_file) {
+            input_file.read(output_file._buffer.get(), PLYSTREAMWRITER_BUFFER_SIZE);
+            output_file._buffer_used = input_file.gcount();
+            output_file.flush();
+        }
+
+        if (!input_file.eof())
+            throw std::runtime_error("PLYStreamWriter: could not read " + input_filepaths[input_i]);
+    }
+
+    output_file.close();
+}
@@ -0,0 +1,33 @@
+/*
+ Classy Voxelizer
+
+ BSD 2-Clause License
+ Copyright (c) 2018, Dario Rethage
+ See LICENSE at package root for full license
+ */
+
+#include "PartialVoxelGrid.h"
+
+bool PartialVoxelGridFile::open(const std::string &filepath) {
+
+    _file.close();
+    _file.clear();
+    _file.open(filepath, std::ios::binary);
+    _class_color_mapping.clear();
+    _num_read = 0;
+
+    if (!_file.read(reinterpret_cast<char *>(&_header), sizeof(_header)))
+        return false;
+
+    if (memcmp(_header.magic, "CVXP", 4) != 0 || _header.version != PARTIALVOXELGRID_VERSION || _header.payload_size == 0)
+        return false;
+
+    std::vector<int32_t> colors(3 * _header.num_classes);
+    if (!colors.empty() && !_file.read(reinterpret_cast<char *>(colors.data()), colors.size() * sizeof(int32_t)))
+        return false;
+
+    for (uint32_t class_i = 0; class_i < _header.num_classes; class_i++)
+        _class_color_mapping.push_back(Eigen::Vector3i(colors[3 * class_i], colors[3 * class_i + 1], colors[3 * class_i + 2]));
+
+    return true;
+}
@@ -0,0 +1,123 @@
+/*
+ Classy Voxelizer
+
+ BSD 2-Clause License
+ Copyright (c) 2018, Dario Rethage
+ See LICENSE at package root for full license
+ */
+
+#include "SparseVoxelOctree.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SPARSEVOXELOCTREE_MMAP
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+SparseVoxelOctreeFile::~SparseVoxelOctreeFile() {
+    close();
+}
+
+bool SparseVoxelOctreeFile::open(const std::string &filepath) {
+
+    close();
+
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+
+#ifdef SPARSEVOXELOCTREE_MMAP
+    int fd = ::open(filepath.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        struct stat file_stat;
+        if (fstat(fd, &file_stat) == 0 && file_stat.st_size >= (off_t) sizeof(SVOHeader)) {
+            void *mapping = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping != MAP_FAILED) {
+                _mapping = mapping;
+                _mapping_size = file_stat.st_size;
+                data = static_cast<const uint8_t *>(mapping);
+                size = file_stat.st_size;
+            }
+        }
+        ::close(fd);
+    }
+#endif
+
+    if (data == nullptr) {
+        std::ifstream input_file(filepath, std::ios::binary | std::ios::ate);
+        if (!input_file)
+            return false;
+        size = input_file.tellg();
+        _buffer.resize((size + 7) / 8);
+        input_file.seekg(0);
+        if (!input_file.read(reinterpret_cast<char *>(_buffer.data()), size))
+            return false;
+        data = reinterpret_cast<const uint8_t *>(_buffer.data());
+    }
+
+    _header = reinterpret_cast<const SVOHeader *>(data);
+
+    bool valid = size >= sizeof(SVOHeader) && memcmp(_header->magic, "CSVO", 4) == 0 && _header->version == SPARSEVOXELOCTREE_VERSION
+                 && _header->num_levels > 0 && _header->payload_size > 0;
+
+    uint64_t nodes_offset = sizeof(SVOHeader) + (valid ? (_header->num_levels + 1) * sizeof(uint64_t) : 0);
+    uint64_t payloads_offset = nodes_offset + (valid ? _header->num_nodes * sizeof(SVONode) : 0);
+    valid = valid && payloads_offset + _header->num_nodes * _header->payload_size <= size;
+
+    if (valid) {
+        _level_begins = reinterpret_cast<const uint64_t *>(data + sizeof(SVOHeader));
+        valid = _level_begins[0] == 0 && _level_begins[_header->num_levels] == _header->num_nodes;
+    }
+
+    if (!valid) {
+        close();
+        return false;
+    }
+
+    _nodes = reinterpret_cast<const SVONode *>(data + nodes_offset);
+    _payloads = data + payloads_offset;
+
+    return true;
+}
+
+void SparseVoxelOctreeFile::close() {
+
+#ifdef SPARSEVOXELOCTREE_MMAP
+    if (_mapping != nullptr)
+        munmap(_mapping, _mapping_size);
+#endif
+
+    _mapping = nullptr;
+    _mapping_size = 0;
+    _buffer.clear();
+    _header = nullptr;
+    _level_begins = nullptr;
+    _nodes = nullptr;
+    _payloads = nullptr;
+}
+
+int64_t SparseVoxelOctreeFile::getChild(uint64_t node, int octant) const {
+
+    uint8_t child_mask = _nodes[node].child_mask;
+    if (((child_mask >> octant) & 1) == 0)
+        return -1;
+
+    return _nodes[node].first_child + __builtin_popcount(child_mask & ((1 << octant) - 1));
+}
+
+// Descends from the root, taking the octant of every coordinate bit from the highest down
+int64_t SparseVoxelOctreeFile::findNode(uint32_t level, uint32_t i, uint32_t j, uint32_t k) const {
+
+    if (level >= _header->num_levels || _header->num_nodes == 0 || ((i | j | k) >> level) != 0)
+        return -1;
+
+    int64_t node = 0;
+    for (uint32_t depth = 0; depth < level && node >= 0; depth++) {
+        int bit = level - 1 - depth;
+        int octant = ((i >> bit) & 1) | (((j >> bit) & 1) << 1) | (((k >> bit) & 1) << 2);
+        node = getChild(node, octant);
+    }
+
+    return node;
+}
@@ -0,0 +1,99 @@
+/*
+ Classy Voxelizer
+
+ BSD 2-Clause License
+ Copyright (c) 2018, Dario Rethage
+ See LICENSE at package root for full license
+ */
+
+#include <fstream>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <algorithm>
+#include <stdexcept>
+
+#include "Stats.h"
+
+namespace {
+
+const char *counter_names[Stats::NUM_COUNTERS] = {
+    "faces", "sub_faces", "midpoints", "max_split_depth", "voxel_writes", "voxels_set", "voxels_overwritten", "occupied_voxels", "bytes_written"
+};
+
+struct PhaseTotal {
+    std::string phase;
+    double seconds;
+    uint64_t calls;
+};
+
+std::mutex stats_mutex;
+// Counter blocks of every thread that recorded, kept after the threads exit
+std::vector<std::unique_ptr<uint64_t[]>> thread_counters;
+// In the order the phases first ended
+std::vector<PhaseTotal> phase_totals;
+std::chrono::steady_clock::time_point start_time;
+
+}
+
+bool Stats::_enabled = false;
+thread_local uint64_t *Stats::_thread_counters = nullptr;
+
+void Stats::enable() {
+    start_time = std::chrono::steady_clock::now();
+    _enabled = true;
+}
+
+uint64_t *Stats::registerThread() {
+
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    thread_counters.emplace_back(new uint64_t[NUM_COUNTERS]());
+    return thread_counters.back().get();
+}
+
+void Stats::addPhaseSeconds(const char *phase, double seconds) {
+
+    std::lock_guard<std::mutex> lock(stats_mutex);
+
+    for (PhaseTotal &total : phase_totals) {
+        if (total.phase == phase) {
+            total.seconds += seconds;
+            total.calls++;
+            return;
+        }
+    }
+
+    phase_totals.push_back({phase, seconds, 1});
+}
+
+void Stats::save(const std::string &filepath) {
+
+    double wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+    std::lock_guard<std::mutex> lock(stats_mutex);
+
+    uint64_t counters[NUM_COUNTERS] = {};
+    for (const std::unique_ptr<uint64_t[]> &block : thread_counters) {
+        for (int counter = 0; counter < NUM_COUNTERS; counter++) {
+            if (counter == MAX_SPLIT_DEPTH)
+                counters[counter] = std::max(counters[counter], block[counter]);
+            else
+                counters[counter] += block[counter];
+        }
+    }
+
+    std::ofstream output_file(filepath);
+
+    output_file << "{\n  \"wall_seconds\": " << wall_seconds << ",\n  \"phases\": {";
+    for (size_t i = 0; i < phase_totals.size(); i++)
+        output_file << (i == 0 ? "\n" : ",\n") << "    \"" << phase_totals[i].phase << "\": {\"seconds\": " << phase_totals[i].seconds
+                    << ", \"calls\": " << phase_totals[i].calls << "}";
+    output_file << "\n  },\n  \"counters\": {";
+    for (int counter = 0; counter < NUM_COUNTERS; counter++)
+        output_file << (counter == 0 ? "\n" : ",\n") << "    \"" << counter_names[counter] << "\": " << counters[counter];
+    output_file << "\n  }\n}\n";
+    output_file.close();
+
+    if (!output_file)
+        throw std::runtime_error("Stats: could not write " + filepath);
+}
@@ -0,0 +1,179 @@
+/*
+ Classy Voxelizer
+
+ BSD 2-Clause License
+ Copyright (c) 2018, Dario Rethage
+ See LICENSE at package root for full license
+ */
+
+#include <fstream>
+#include <vector>
+#include <set>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <stdexcept>
+
+#include "Trace.h"
+
+namespace {
+
+struct TraceEvent {
+    const char *name;
+    const char *detail;
+    uint64_t begin;
+    uint64_t end;
+};
+
+// Only its leaseholder writes to a ring; num_recorded counts every event ever recorded, the ring keeps the last ones
+struct TraceRing {
+    std::unique_ptr<TraceEvent[]> events;
+    std::atomic<uint64_t> num_recorded;
+    std::vector<std::string> thread_names;
+    bool leased;
+};
+
+std::mutex trace_mutex;
+std::vector<std::unique_ptr<TraceRing>> rings;
+// Details of the spans, a set so the copies never move
+std::set<std::string> details;
+std::chrono::steady_clock::time_point start_time;
+
+thread_local TraceRing *thread_ring = nullptr;
+
+// Hands the ring back when its thread exits
+struct RingLease {
+    TraceRing *ring = nullptr;
+
+    ~RingLease() {
+        if (ring == nullptr)
+            return;
+        std::lock_guard<std::mutex> lock(trace_mutex);
+        ring->leased = false;
+    }
+};
+
+TraceRing *getThreadRing() {
+
+    if (thread_ring != nullptr)
+        return thread_ring;
+
+    static thread_local RingLease lease;
+    std::lock_guard<std::mutex> lock(trace_mutex);
+
+    auto free_ring = std::find_if(rings.begin(), rings.end(), [](const std::unique_ptr<TraceRing> &ring) { return !ring->leased; });
+    if (free_ring == rings.end()) {
+        rings.emplace_back(new TraceRing());
+        rings.back()->events.reset(new TraceEvent[TRACE_EVENTS_PER_THREAD]);
+        rings.back()->num_recorded = 0;
+        free_ring = rings.end() - 1;
+    }
+
+    thread_ring = free_ring->get();
+    thread_ring->leased = true;
+    lease.ring = thread_ring;
+    return thread_ring;
+}
+
+void writeJSONString(std::ostream &os, const std::string &value) {
+
+    os << '"';
+    for (char c : value) {
+        if (c == '"' || c == '\\')
+            os << '\\' << c;
+        else if ((unsigned char) c < 0x20)
+            os << "\\u00" << "0123456789abcdef"[(c >> 4) & 0xf] << "0123456789abcdef"[c & 0xf];
+        else
+            os << c;
+    }
+    os << '"';
+}
+
+}
+
+bool Trace::_enabled = false;
+
+void Trace::enable() {
+    start_time = std::chrono::steady_clock::now();
+    _enabled = true;
+}
+
+uint64_t Trace::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+void Trace::record(const char *name, const char *detail, uint64_t begin, uint64_t end) {
+
+    TraceRing *ring = getThreadRing();
+    uint64_t event_i = ring->num_recorded.load(std::memory_order_relaxed);
+    ring->events[event_i & (TRACE_EVENTS_PER_THREAD - 1)] = {name, detail, begin, end};
+    ring->num_recorded.store(event_i + 1, std::memory_order_release);
+}
+
+void Trace::nameThread(const char *name) {
+
+    TraceRing *ring = getThreadRing();
+    std::lock_guard<std::mutex> lock(trace_mutex);
+    if (std::find(ring->thread_names.begin(), ring->thread_names.end(), name) == ring->thread_names.end())
+        ring->thread_names.push_back(name);
+}
+
+const char *Trace::intern(const std::string &detail) {
+
+    std::lock_guard<std::mutex> lock(trace_mutex);
+    return details.insert(detail).first->c_str();
+}
+
+// Spans are complete ("X") events in microseconds, every ring's lane gets a thread_name metadata event
+void Trace::save(const std::string &filepath) {
+
+    std::lock_guard<std::mutex> lock(trace_mutex);
+
+    std::ofstream output_file(filepath);
+    output_file.setf(std::ios::fixed);
+    output_file.precision(3);
+
+    output_file << "{\"traceEvents\": [\n  {\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 0, \"args\": {\"name\": \"classy_voxelizer\"}}";
+
+    uint64_t num_dropped = 0;
+
+    for (size_t lane = 0; lane < rings.size(); lane++) {
+
+        const TraceRing &ring = *rings[lane];
+
+        std::string lane_name;
+        for (const std::string &thread_name : ring.thread_names)
+            lane_name += (lane_name.empty() ? "" : " / ") + thread_name;
+        if (lane_name.empty())
+            lane_name = "thread";
+
+        output_file << ",\n  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << lane << ", \"args\": {\"name\": ";
+        writeJSONString(output_file, lane_name);
+        output_file << "}}";
+
+        uint64_t num_recorded = ring.num_recorded.load(std::memory_order_acquire);
+        uint64_t first_kept = (num_recorded > TRACE_EVENTS_PER_THREAD) ? num_recorded - TRACE_EVENTS_PER_THREAD : 0;
+        num_dropped += first_kept;
+
+        for (uint64_t event_i = first_kept; event_i < num_recorded; event_i++) {
+
+            const TraceEvent &event = ring.events[event_i & (TRACE_EVENTS_PER_THREAD - 1)];
+            output_file << ",\n  {\"name\": \"" << event.name << "\", \"cat\": \"classy_voxelizer\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << lane
+                        << ", \"ts\": " << event.begin / 1e3 << ", \"dur\": " << (event.end - event.begin) / 1e3;
+            if (event.detail != nullptr) {
+                output_file << ", \"args\": {\"detail\": ";
+                writeJSONString(output_file, event.detail);
+                output_file << "}";
+            }
+            output_file << "}";
+        }
+    }
+
+    output_file << "\n],\n\"displayTimeUnit\": \"ms\",\n\"otherData\": {\"dropped_events\": " << num_dropped << "}}\n";
+    output_file.close();
+
+    if (!output_file)
+        throw std::runtime_error("Trace: could not write " + filepath);
+}
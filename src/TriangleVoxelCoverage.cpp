@@ -0,0 +1,167 @@
+/*
+ Classy Voxelizer
+
+ BSD 2-Clause License
+ Copyright (c) 2018, Dario Rethage
+ See LICENSE at package root for full license
+ */
+
+#include "TriangleVoxelCoverage.h"
+
+#include <algorithm>
+
+TriangleVoxelCoverage::TriangleVoxelCoverage(Eigen::Vector3f grid_min, Eigen::Vector3i voxels_per_dim, float voxel_size, Separability separability) {
+
+    _grid_min = grid_min.cast<double>();
+    _voxels_per_dim = voxels_per_dim;
+    _voxel_size = voxel_size;
+    _separability = separability;
+
+}
+
+uint64_t TriangleVoxelCoverage::getVoxelID(int i, int j, int k) const {
+    return (uint64_t) _voxels_per_dim[0] * _voxels_per_dim[1] * k + (uint64_t) _voxels_per_dim[0] * j + i;
+}
+
+int TriangleVoxelCoverage::getClosestCorner(const CoveredVoxel &covered_voxel) {
+
+    int closest_i = 0;
+    for (int i = 1; i < 3; i++) {
+        if (covered_voxel.weights[i] > covered_voxel.weights[closest_i])
+            closest_i = i;
+    }
+
+    return closest_i;
+}
+
+void TriangleVoxelCoverage::coverCorners(const Eigen::Vector3d vertices[3], std::vector<CoveredVoxel> &covered) const {
+
+    for (int i = 0; i < 3; i++) {
+
+        Eigen::Vector3d voxel = vertices[i].array().floor();
+        if (!voxel.allFinite() || (voxel.array() < 0).any() || (voxel.array() >= _voxels_per_dim.cast<double>().array()).any())
+            continue;
+
+        CoveredVoxel corner = {getVoxelID(voxel[0], voxel[1], voxel[2]), {0, 0, 0}};
+        corner.weights[i] = 1;
+        covered.push_back(corner);
+    }
+
+}
+
+// Box/plane and box/edge tests follow Schwarz & Seidel, "Fast Parallel Surface and Solid Voxelization on GPUs" (2010),
+// evaluated at voxel centers in grid space where a voxel is the unit cube. The conservative test is the exact
+// separating-axis overlap test. The separating variants keep the voxels that pass it and also lie within the 26- or
+// 6-separating plane thickness and, for 6, the thinner 6-separating edge test in the dominant projection; they
+// include a voxel lying exactly on the plane only on its upper side.
+void TriangleVoxelCoverage::cover(const Eigen::Vector3f &vertex_1, const Eigen::Vector3f &vertex_2, const Eigen::Vector3f &vertex_3, std::vector<CoveredVoxel> &covered) const {
+
+    Eigen::Vector3d v[3] = {
+        (vertex_1.cast<double>() - _grid_min) / _voxel_size,
+        (vertex_2.cast<double>() - _grid_min) / _voxel_size,
+        (vertex_3.cast<double>() - _grid_min) / _voxel_size
+    };
+    Eigen::Vector3d e[3] = {v[1] - v[0], v[2] - v[1], v[0] - v[2]};
+    Eigen::Vector3d n = e[0].cross(e[1]);
+
+    if (!(n.squaredNorm() > 0)) {
+        coverCorners(v, covered);
+        return;
+    }
+
+    int w;
+    n.cwiseAbs().maxCoeff(&w);
+    int u = (w + 1) % 3, vv = (w + 2) % 3;
+
+    bool thin = _separability != CONSERVATIVE;
+    double plane_offset = n.dot(v[0]);
+    double plane_extent = (_separability == SEPARATING_6) ? 0.5 * n.cwiseAbs().maxCoeff() : 0.5 * n.cwiseAbs().sum();
+    double plane_sign = (n[w] >= 0) ? 1 : -1;
+
+    // edge functions of the projected triangle, offset by the projected voxel's extent: inside where >= 0
+    struct EdgeTest { int a, b; double n_a, n_b, offset; };
+    EdgeTest edge_tests[9];
+    int num_edge_tests = 0;
+
+    for (int axis = 0; axis < 3; axis++) {
+
+        int a = (axis + 1) % 3, b = (axis + 2) % 3;
+        double sign = (n[axis] >= 0) ? 1 : -1;
+
+        for (int i = 0; i < 3; i++) {
+            double n_a = -e[i][b] * sign, n_b = e[i][a] * sign;
+            double extent = (_separability == SEPARATING_6 && axis == w) ? 0.5 * std::max(std::abs(n_a), std::abs(n_b)) : 0.5 * (std::abs(n_a) + std::abs(n_b));
+            edge_tests[num_edge_tests++] = {a, b, n_a, n_b, extent - (n_a * v[i][a] + n_b * v[i][b])};
+        }
+    }
+
+    // least-squares barycentric coordinates, i.e. those of the center's projection onto the triangle plane
+    Eigen::Vector3d b1 = v[1] - v[0], b2 = v[2] - v[0];
+    double d11 = b1.dot(b1), d12 = b1.dot(b2), d22 = b2.dot(b2);
+    double denominator = d11 * d22 - d12 * d12;
+
+    double min_u = std::min(v[0][u], std::min(v[1][u], v[2][u])), max_u = std::max(v[0][u], std::max(v[1][u], v[2][u]));
+    double min_v = std::min(v[0][vv], std::min(v[1][vv], v[2][vv])), max_v = std::max(v[0][vv], std::max(v[1][vv], v[2][vv]));
+    double min_w = std::min(v[0][w], std::min(v[1][w], v[2][w])), max_w = std::max(v[0][w], std::max(v[1][w], v[2][w]));
+
+    int iu_begin = std::max(0, (int) std::ceil(min_u) - 1), iu_end = std::min(_voxels_per_dim[u] - 1, (int) std::floor(max_u));
+    int iv_begin = std::max(0, (int) std::ceil(min_v) - 1), iv_end = std::min(_voxels_per_dim[vv] - 1, (int) std::floor(max_v));
+    int iw_min = std::max(0, (int) std::ceil(min_w) - 1), iw_max = std::min(_voxels_per_dim[w] - 1, (int) std::floor(max_w));
+
+    for (int iu = iu_begin; iu <= iu_end; iu++) {
+        for (int iv = iv_begin; iv <= iv_end; iv++) {
+
+            // the plane's extent along w over this column, widened by a voxel against rounding, within the
+            // triangle's own extent along w: the box axis w is a separating axis too
+            double min_plane_w = INFINITY, max_plane_w = -INFINITY;
+            for (int corner = 0; corner < 4; corner++) {
+                double plane_w = (plane_offset - n[u] * (iu + (corner & 1)) - n[vv] * (iv + (corner >> 1))) / n[w];
+                min_plane_w = std::min(min_plane_w, plane_w);
+                max_plane_w = std::max(max_plane_w, plane_w);
+            }
+
+            int iw_begin = std::max<double>(iw_min, std::floor(min_plane_w) - 1), iw_end = std::min<double>(iw_max, std::floor(max_plane_w) + 1);
+
+            for (int iw = iw_begin; iw <= iw_end; iw++) {
+
+                Eigen::Vector3d center;
+                center[u] = iu + 0.5;
+                center[vv] = iv + 0.5;
+                center[w] = iw + 0.5;
+
+                double distance = n.dot(center) - plane_offset;
+                if (thin) {
+                    distance *= plane_sign;
+                    if (distance <= -plane_extent || distance > plane_extent)
+                        continue;
+                } else if (std::abs(distance) > plane_extent) {
+                    continue;
+                }
+
+                bool inside = true;
+                for (int i = 0; i < num_edge_tests && inside; i++)
+                    inside = edge_tests[i].n_a * center[edge_tests[i].a] + edge_tests[i].n_b * center[edge_tests[i].b] + edge_tests[i].offset >= 0;
+
+                if (!inside)
+                    continue;
+
+                Eigen::Vector3d offset = center - v[0];
+                double d1 = offset.dot(b1), d2 = offset.dot(b2);
+                double weights[3];
+                weights[1] = std::max(0.0, (d22 * d1 - d12 * d2) / denominator);
+                weights[2] = std::max(0.0, (d11 * d2 - d12 * d1) / denominator);
+                weights[0] = std::max(0.0, 1 - weights[1] - weights[2]);
+                double weight_sum = weights[0] + weights[1] + weights[2];
+
+                Eigen::Vector3i voxel;
+                voxel[u] = iu;
+                voxel[vv] = iv;
+                voxel[w] = iw;
+
+                CoveredVoxel covered_voxel = {getVoxelID(voxel[0], voxel[1], voxel[2]), {(float) (weights[0] / weight_sum), (float) (weights[1] / weight_sum), (float) (weights[2] / weight_sum)}};
+                covered.push_back(covered_voxel);
+            }
+        }
+    }
+
+}
@@ -0,0 +1,138 @@
+/*
+ Classy Voxelizer
+
+ BSD 2-Clause License
+ Copyright (c) 2018, Dario Rethage
+ See LICENSE at package root for full license
+ */
+
+#include "VoxelIndexer.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define VOXELINDEXER_X86_64
+#include <immintrin.h>
+#endif
+
+VoxelIndexer::VoxelIndexer(Eigen::Vector3f grid_min, Eigen::Vector3f grid_max, float voxel_size, Eigen::Vector3i voxels_per_dim) {
+
+    _grid_min = grid_min;
+    _grid_max = grid_max;
+    _inverse_voxel_size = 1.0f / voxel_size;
+    _voxels_per_row = voxels_per_dim[0];
+    _voxels_per_slice = (int64_t) voxels_per_dim[0] * voxels_per_dim[1];
+
+}
+
+void VoxelIndexer::getEnclosingVoxelIDs(const Eigen::Vector3f *vertices, size_t num_vertices, int64_t *voxel_ids) const {
+
+#ifdef VOXELINDEXER_X86_64
+    // the kernels multiply voxel coordinates with the row and slice sizes in 32x32 -> 64 bit products
+    if (_voxels_per_slice <= UINT32_MAX) {
+
+        if (__builtin_cpu_supports("avx2"))
+            getEnclosingVoxelIDsAVX2(vertices, num_vertices, voxel_ids);
+        else
+            getEnclosingVoxelIDsSSE2(vertices, num_vertices, voxel_ids);
+
+        return;
+    }
+#endif
+
+    getEnclosingVoxelIDsScalar(vertices, num_vertices, voxel_ids);
+}
+
+void VoxelIndexer::getEnclosingVoxelIDsScalar(const Eigen::Vector3f *vertices, size_t num_vertices, int64_t *voxel_ids) const {
+
+    for (size_t i = 0; i < num_vertices; i++)
+        voxel_ids[i] = getEnclosingVoxelID(vertices[i]);
+}
+
+#ifdef VOXELINDEXER_X86_64
+
+// 4 vertices at a time. Truncation equals std::floor here since in-grid offsets are never negative.
+void VoxelIndexer::getEnclosingVoxelIDsSSE2(const Eigen::Vector3f *vertices, size_t num_vertices, int64_t *voxel_ids) const {
+
+    const __m128 inverse_voxel_size = _mm_set1_ps(_inverse_voxel_size);
+    const __m128i voxels_per_row = _mm_set1_epi64x(_voxels_per_row);
+    const __m128i voxels_per_slice = _mm_set1_epi64x(_voxels_per_slice);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i outside = _mm_set1_epi64x(-1);
+
+    size_t i = 0;
+    for (; i + 4 <= num_vertices; i += 4) {
+
+        const Eigen::Vector3f *v = vertices + i;
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        __m128i index[3];
+
+        for (int axis = 0; axis < 3; axis++) {
+            __m128 coordinate = _mm_setr_ps(v[0][axis], v[1][axis], v[2][axis], v[3][axis]);
+            __m128 grid_min = _mm_set1_ps(_grid_min[axis]);
+            inside = _mm_and_ps(inside, _mm_and_ps(_mm_cmpge_ps(coordinate, grid_min), _mm_cmple_ps(coordinate, _mm_set1_ps(_grid_max[axis]))));
+            index[axis] = _mm_cvttps_epi32(_mm_mul_ps(_mm_sub_ps(coordinate, grid_min), inverse_voxel_size));
+        }
+
+        __m128i inside_mask = _mm_castps_si128(inside);
+
+        // vertices 0,1 from the low halves, 2,3 from the high halves, widened to 64 bit
+        __m128i ids_low = _mm_add_epi64(_mm_unpacklo_epi32(index[0], zero),
+                          _mm_add_epi64(_mm_mul_epu32(_mm_unpacklo_epi32(index[1], zero), voxels_per_row),
+                                        _mm_mul_epu32(_mm_unpacklo_epi32(index[2], zero), voxels_per_slice)));
+        __m128i ids_high = _mm_add_epi64(_mm_unpackhi_epi32(index[0], zero),
+                           _mm_add_epi64(_mm_mul_epu32(_mm_unpackhi_epi32(index[1], zero), voxels_per_row),
+                                         _mm_mul_epu32(_mm_unpackhi_epi32(index[2], zero), voxels_per_slice)));
+
+        __m128i mask_low = _mm_unpacklo_epi32(inside_mask, inside_mask);
+        __m128i mask_high = _mm_unpackhi_epi32(inside_mask, inside_mask);
+
+        _mm_storeu_si128((__m128i *) (voxel_ids + i), _mm_or_si128(_mm_and_si128(mask_low, ids_low), _mm_andnot_si128(mask_low, outside)));
+        _mm_storeu_si128((__m128i *) (voxel_ids + i + 2), _mm_or_si128(_mm_and_si128(mask_high, ids_high), _mm_andnot_si128(mask_high, outside)));
+    }
+
+    getEnclosingVoxelIDsScalar(vertices + i, num_vertices - i, voxel_ids + i);
+}
+
+// 8 vertices at a time, gathered straight out of the packed xyz array
+__attribute__((target("avx2")))
+void VoxelIndexer::getEnclosingVoxelIDsAVX2(const Eigen::Vector3f *vertices, size_t num_vertices, int64_t *voxel_ids) const {
+
+    const __m256i gather_offsets = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+    const __m256 inverse_voxel_size = _mm256_set1_ps(_inverse_voxel_size);
+    const __m256i voxels_per_row = _mm256_set1_epi64x(_voxels_per_row);
+    const __m256i voxels_per_slice = _mm256_set1_epi64x(_voxels_per_slice);
+    const __m256i outside = _mm256_set1_epi64x(-1);
+
+    size_t i = 0;
+    for (; i + 8 <= num_vertices; i += 8) {
+
+        const float *coordinates = vertices[i].data();
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        __m256i index[3];
+
+        for (int axis = 0; axis < 3; axis++) {
+            __m256 coordinate = _mm256_i32gather_ps(coordinates + axis, gather_offsets, 4);
+            __m256 grid_min = _mm256_set1_ps(_grid_min[axis]);
+            inside = _mm256_and_ps(inside, _mm256_and_ps(_mm256_cmp_ps(coordinate, grid_min, _CMP_GE_OQ), _mm256_cmp_ps(coordinate, _mm256_set1_ps(_grid_max[axis]), _CMP_LE_OQ)));
+            index[axis] = _mm256_cvttps_epi32(_mm256_floor_ps(_mm256_mul_ps(_mm256_sub_ps(coordinate, grid_min), inverse_voxel_size)));
+        }
+
+        __m256i inside_mask = _mm256_castps_si256(inside);
+
+        __m256i ids_low = _mm256_add_epi64(_mm256_cvtepu32_epi64(_mm256_castsi256_si128(index[0])),
+                          _mm256_add_epi64(_mm256_mul_epu32(_mm256_cvtepu32_epi64(_mm256_castsi256_si128(index[1])), voxels_per_row),
+                                           _mm256_mul_epu32(_mm256_cvtepu32_epi64(_mm256_castsi256_si128(index[2])), voxels_per_slice)));
+        __m256i ids_high = _mm256_add_epi64(_mm256_cvtepu32_epi64(_mm256_extracti128_si256(index[0], 1)),
+                           _mm256_add_epi64(_mm256_mul_epu32(_mm256_cvtepu32_epi64(_mm256_extracti128_si256(index[1], 1)), voxels_per_row),
+                                            _mm256_mul_epu32(_mm256_cvtepu32_epi64(_mm256_extracti128_si256(index[2], 1)), voxels_per_slice)));
+
+        __m256i mask_low = _mm256_cvtepi32_epi64(_mm256_castsi256_si128(inside_mask));
+        __m256i mask_high = _mm256_cvtepi32_epi64(_mm256_extracti128_si256(inside_mask, 1));
+
+        _mm256_storeu_si256((__m256i *) (voxel_ids + i), _mm256_blendv_epi8(outside, ids_low, mask_low));
+        _mm256_storeu_si256((__m256i *) (voxel_ids + i + 4), _mm256_blendv_epi8(outside, ids_high, mask_high));
+    }
+
+    getEnclosingVoxelIDsScalar(vertices + i, num_vertices - i, voxel_ids + i);
+}
+
+#endif
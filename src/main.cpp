@@ -13,242 +13,816 @@
 #include <string>
 #include <vector>
 #include <set>
-
-#include "tinyply.h"
+#include <map>
+#include <limits>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <memory>
+#include <functional>
+
+#include "BoundedQueue.h"
+#include "MeshReader.h"
+#include "TiledVoxelizer.h"
+#include "ColorClassMapper.h"
 #include "MultiClassVoxelGrid.h"
 #include "MultiClassVoxelizer.h"
 #include "ColoredVoxelizer.h"
 #include "ColoredVoxelGrid.h"
+#include "Stats.h"
+#include "Trace.h"
+
+// Voxelizes with the engine selected on the command line; Payload, Reducer and Storage pick the voxelizer at compile time
+template <typename Reducer, typename Storage, typename Payload>
+VoxelGrid<Payload, Storage> voxelizeMesh(const std::vector<Eigen::Vector3f> &vertices, const std::vector<uint32_t> &faces, const std::vector<Payload> &vertex_payloads, Eigen::Vector3f min, Eigen::Vector3f max, float voxel_size, bool overlap_engine, TriangleVoxelCoverage::Separability separability, unsigned int num_threads, VoxelBox region = VoxelBox()) {
 
-bool readPlyWithLabelProperties(std::string filepath, std::vector<Eigen::Vector3f> &vertices, std::vector<uint32_t> &faces, std::vector<uint8_t> &classes, std::vector<Eigen::Vector3i> &colormap) {
+    if (overlap_engine)
+        return Voxelizer<Payload, Reducer, Storage>::voxelizeOverlap(vertices, faces, vertex_payloads, min, max, voxel_size, separability, num_threads, region);
 
-    std::ifstream ss(filepath, std::ios::binary);
+    return Voxelizer<Payload, Reducer, Storage>::voxelize(vertices, faces, vertex_payloads, min, max, voxel_size, num_threads, region);
+}
 
-    tinyply::PlyFile input_file(ss);
+// <name><suffix>.<extension> for <name>.<extension>
+std::string insertBeforeExtension(const std::string &filepath, const std::string &suffix) {
 
-    std::vector<float> raw_vertices;
-    std::vector<uint8_t> raw_colors;
-    std::vector<unsigned short> raw_classes;
-    uint32_t num_vertices, num_colors, num_faces, num_classes;
-    num_vertices = num_colors = num_faces = 0;
+    size_t extension = filepath.find_last_of('.');
+    if (extension == std::string::npos || filepath.find_first_of("/\\", extension) != std::string::npos)
+        extension = filepath.size();
 
-    num_vertices = input_file.request_properties_from_element("vertex", { "x", "y", "z" }, raw_vertices);
-    num_colors = input_file.request_properties_from_element("vertex", { "red", "green", "blue" }, raw_colors);
-    num_classes = input_file.request_properties_from_element("vertex", { "label" }, raw_classes);
-    num_faces = input_file.request_properties_from_element("face", { "vertex_indices" }, faces, 3);
+    return filepath.substr(0, extension) + suffix + filepath.substr(extension);
+}
 
-    input_file.read(ss);
+// Level 0 is saved to filepath, coarser levels l next to it as <name>_level<l>.<extension>
+std::string getLevelFilepath(const std::string &filepath, unsigned int level) {
+    return (level == 0) ? filepath : insertBeforeExtension(filepath, "_level" + std::to_string(level));
+}
 
-    vertices.resize(num_vertices);
-    std::vector<Eigen::Vector3i> colors(num_vertices);
+// Tiles are saved next to filepath as <name>_tile<i>_<j>_<k>.<extension>
+std::string getTileFilepath(const std::string &filepath, const Eigen::Vector3i &tile) {
+    return insertBeforeExtension(filepath, "_tile" + std::to_string(tile[0]) + "_" + std::to_string(tile[1]) + "_" + std::to_string(tile[2]));
+}
 
-    int raw_vertices_i = 0;
-    int raw_colors_i = 0;
-    for (int i = 0; i < num_vertices; i++) {
+// Saves class grids of any storage as PLY, optionally with label properties, or as an octree built on num_threads threads
+struct ClassGridSaver {
+    std::string filepath;
+    std::vector<Eigen::Vector3i> colormap;
+    bool dense;
+    bool label_properties;
+    bool octree;
+    unsigned int num_threads;
+
+    template <typename Grid>
+    void operator()(Grid &voxel_grid, unsigned int level) const {
+        if (octree)
+            voxel_grid.saveAsSVO(getLevelFilepath(filepath, level), num_threads);
+        else if (label_properties)
+            voxel_grid.saveAsPLYWithLabelProperties(getLevelFilepath(filepath, level), colormap, dense);
+        else
+            voxel_grid.saveAsPLY(getLevelFilepath(filepath, level), colormap, dense);
+    }
+};
+
+// Saves color grids of any storage as PLY, or as an octree built on num_threads threads
+struct ColorGridSaver {
+    std::string filepath;
+    bool dense;
+    bool octree;
+    unsigned int num_threads;
+
+    template <typename Grid>
+    void operator()(Grid &voxel_grid, unsigned int level) const {
+        if (octree)
+            voxel_grid.saveAsSVO(getLevelFilepath(filepath, level), num_threads);
+        else
+            voxel_grid.saveAsPLY(getLevelFilepath(filepath, level), dense);
+    }
+};
+
+// Hands a grid's write to a writer, e.g. a background thread
+typedef std::function<void(std::function<void()>)> GridWriter;
+
+// Moves the grid out of the voxelizer so Saver can run on the writer, after the voxelizer has moved on
+template <typename Saver>
+struct DeferredSaver {
+    Saver save;
+    const GridWriter &writer;
+
+    template <typename Grid>
+    void operator()(Grid &voxel_grid, unsigned int level) const {
+        std::shared_ptr<Grid> grid = std::make_shared<Grid>(std::move(voxel_grid));
+        Saver save_grid = save;
+        writer([grid, save_grid, level]() { save_grid(*grid, level); });
+    }
 
-        vertices[i][0] = raw_vertices[raw_vertices_i++];
-        vertices[i][1] = raw_vertices[raw_vertices_i++];
-        vertices[i][2] = raw_vertices[raw_vertices_i++];
+    DeferredSaver withFilepath(const std::string &filepath) const {
+        DeferredSaver saver = *this;
+        saver.save.filepath = filepath;
+        return saver;
+    }
+};
 
-        colors[i][0] = raw_colors[raw_colors_i++];
-        colors[i][1] = raw_colors[raw_colors_i++];
-        colors[i][2] = raw_colors[raw_colors_i++];
+// Hands the grid to save as level 0, then every coarser level up to num_levels - 1, each derived from the one before.
+// A level is downsampled before it is saved, as save may move it away.
+template <typename Grid, typename Saver>
+void saveLevels(Grid &voxel_grid, unsigned int num_levels, unsigned int num_threads, const Saver &save) {
 
+    for (unsigned int level = 0; level + 1 < num_levels; level++) {
+        Grid coarser_grid = voxel_grid.downsample(num_threads);
+        save(voxel_grid, level);
+        voxel_grid = std::move(coarser_grid);
     }
 
-    classes.resize(num_classes);
-    for (int i = 0; i < num_classes; ++i) {
-        classes[i] = static_cast<uint8_t>(raw_classes[i]);
+    save(voxel_grid, std::max(num_levels, 1u) - 1);
+}
+
+// Picks the storage selected on the command line, voxelizes and hands the grid and its coarser levels to save
+template <typename Reducer, typename Payload, typename Saver>
+void voxelizeAndSave(const std::vector<Eigen::Vector3f> &vertices, const std::vector<uint32_t> &faces, const std::vector<Payload> &vertex_payloads, Eigen::Vector3f min, Eigen::Vector3f max, float voxel_size, bool overlap_engine, TriangleVoxelCoverage::Separability separability, unsigned int num_threads, bool sparse_storage, unsigned int num_levels, const Saver &save) {
+
+    if (sparse_storage) {
+        VoxelGrid<Payload, SparseVoxelStorage<Payload>> voxel_grid = voxelizeMesh<Reducer, SparseVoxelStorage<Payload>>(vertices, faces, vertex_payloads, min, max, voxel_size, overlap_engine, separability, num_threads);
+        saveLevels(voxel_grid, num_levels, num_threads, save);
+    } else {
+        VoxelGrid<Payload, DenseVoxelStorage<Payload>> voxel_grid = voxelizeMesh<Reducer, DenseVoxelStorage<Payload>>(vertices, faces, vertex_payloads, min, max, voxel_size, overlap_engine, separability, num_threads);
+        saveLevels(voxel_grid, num_levels, num_threads, save);
     }
+}
 
-    return true;
+// Most levels --levels accepts: octrees, like grids of them, span at most 2^21 voxels per dimension
+#define MAX_LEVELS 22
+
+// Options that apply to every file voxelized in a run
+struct VoxelizerOptions {
+    unsigned int num_threads = 1;
+    unsigned int num_jobs = 0;
+    unsigned int queue_depth = 2;
+    unsigned int num_levels = 1;
+    bool overlap_engine = false;
+    bool sparse_storage = false;
+    bool octree = false;
+    int tile_size = 0;
+    bool merge_tiles = true;
+    int shard_index = -1;
+    int num_shards = 0;
+    bool global_grid = false;
+    Eigen::Vector3f grid_min;
+    Eigen::Vector3f grid_max;
+    std::string merge = "last";
+    std::string palette_filepath;
+    std::string stats_filepath;
+    std::string trace_filepath;
+    TriangleVoxelCoverage::Separability separability = TriangleVoxelCoverage::CONSERVATIVE;
+};
+
+// Parses argv[first_arg] onwards, returns the unknown option, or the option with an invalid value, or an empty string
+std::string parseOptions(int argc, char* argv[], int first_arg, VoxelizerOptions &options) {
+
+    for (int arg_i = first_arg; arg_i < argc; arg_i++) {
+
+        std::string option = argv[arg_i];
+
+        // std::stoi and std::stof throw on values that are not numbers
+        try {
+            if (option == "--threads" && arg_i + 1 < argc && std::stoi(argv[arg_i + 1]) >= 0) {
+                options.num_threads = std::stoi(argv[++arg_i]);
+            } else if (option == "--jobs" && arg_i + 1 < argc && std::stoi(argv[arg_i + 1]) >= 0) {
+                options.num_jobs = std::stoi(argv[++arg_i]);
+            } else if (option == "--levels" && arg_i + 1 < argc && std::stoi(argv[arg_i + 1]) >= 1 && std::stoi(argv[arg_i + 1]) <= MAX_LEVELS) {
+                options.num_levels = std::stoi(argv[++arg_i]);
+            } else if (option == "--queue" && arg_i + 1 < argc && std::stoi(argv[arg_i + 1]) >= 1) {
+                options.queue_depth = std::stoi(argv[++arg_i]);
+            } else if (option == "--engine" && arg_i + 1 < argc && (std::string(argv[arg_i + 1]) == "split" || std::string(argv[arg_i + 1]) == "sat")) {
+                options.overlap_engine = (std::string(argv[++arg_i]) == "sat");
+            } else if (option == "--storage" && arg_i + 1 < argc && (std::string(argv[arg_i + 1]) == "dense" || std::string(argv[arg_i + 1]) == "sparse")) {
+                options.sparse_storage = (std::string(argv[++arg_i]) == "sparse");
+            } else if (option == "--format" && arg_i + 1 < argc && (std::string(argv[arg_i + 1]) == "ply" || std::string(argv[arg_i + 1]) == "svo")) {
+                options.octree = (std::string(argv[++arg_i]) == "svo");
+            } else if (option == "--tiles" && arg_i + 1 < argc && std::stoi(argv[arg_i + 1]) >= 1) {
+                options.tile_size = std::stoi(argv[++arg_i]);
+            } else if (option == "--tile-output" && arg_i + 1 < argc && (std::string(argv[arg_i + 1]) == "merged" || std::string(argv[arg_i + 1]) == "separate")) {
+                options.merge_tiles = (std::string(argv[++arg_i]) == "merged");
+            } else if (option == "--shard" && arg_i + 2 < argc && std::stoi(argv[arg_i + 1]) >= 0 && std::stoi(argv[arg_i + 1]) < std::stoi(argv[arg_i + 2])) {
+                options.shard_index = std::stoi(argv[++arg_i]);
+                options.num_shards = std::stoi(argv[++arg_i]);
+            } else if (option == "--grid" && arg_i + 6 < argc) {
+                options.global_grid = true;
+                for (int i = 0; i < 3; i++)
+                    options.grid_min[i] = std::stof(argv[++arg_i]);
+                for (int i = 0; i < 3; i++)
+                    options.grid_max[i] = std::stof(argv[++arg_i]);
+            } else if (option == "--merge" && arg_i + 1 < argc && (std::string(argv[arg_i + 1]) == "last" || std::string(argv[arg_i + 1]) == "majority" || std::string(argv[arg_i + 1]) == "average")) {
+                options.merge = argv[++arg_i];
+            } else if (option == "--palette" && arg_i + 1 < argc) {
+                options.palette_filepath = argv[++arg_i];
+            } else if (option == "--stats" && arg_i + 1 < argc) {
+                options.stats_filepath = argv[++arg_i];
+            } else if (option == "--trace" && arg_i + 1 < argc) {
+                options.trace_filepath = argv[++arg_i];
+            } else if (option == "--separating" && arg_i + 1 < argc && (std::string(argv[arg_i + 1]) == "6" || std::string(argv[arg_i + 1]) == "26")) {
+                options.separability = (std::string(argv[++arg_i]) == "6") ? TriangleVoxelCoverage::SEPARATING_6 : TriangleVoxelCoverage::SEPARATING_26;
+            } else {
+                return option;
+            }
+        } catch (const std::logic_error &) {
+            return option;
+        }
+    }
 
+    return "";
 }
 
-bool readPlyWithClass(std::string filepath, std::vector<Eigen::Vector3f> &vertices, std::vector<uint32_t> &faces, std::vector<uint8_t> &classes, std::vector<Eigen::Vector3i> &colormap) {
+// A mesh read and mapped for voxelization. Tiled runs leave the faces in the file to stream them later.
+struct MeshData {
+    std::string filepath;
+    std::vector<Eigen::Vector3f> vertices;
+    std::vector<uint32_t> faces;
+    std::vector<uint8_t> vertex_classes;
+    std::vector<Eigen::Vector3i> colormap;
+    std::vector<PackedColor> colors;
+    Eigen::Vector3f min;
+    Eigen::Vector3f max;
+};
+
+// Throws std::runtime_error if the mapping is unknown or the merge policy doesn't fit it
+void checkMapping(const std::string &mapping, const VoxelizerOptions &options) {
 
-    std::ifstream ss(filepath, std::ios::binary);
+    bool class_mapping = (mapping == "color" || mapping == "labels");
+    if (!class_mapping && mapping != "none")
+        throw std::runtime_error("unknown color mapping: " + mapping);
+
+    if ((options.merge == "majority" && !class_mapping) || (options.merge == "average" && class_mapping))
+        throw std::runtime_error("--merge majority needs a color or labels mapping, --merge average the none mapping");
+}
 
-    tinyply::PlyFile input_file(ss);
+// Levels past the first one of a single voxel would all be that voxel, so a grid of max_voxels_per_dim voxels along
+// its longest side has no more than 1 + ceil(log2(max_voxels_per_dim)) levels
+void checkLevels(unsigned int num_levels, int64_t max_voxels_per_dim, const std::string &name) {
+
+    unsigned int max_levels = 1;
+    while (((int64_t) 1 << (max_levels - 1)) < max_voxels_per_dim)
+        max_levels++;
+
+    if (num_levels > max_levels)
+        throw std::runtime_error("--levels " + std::to_string(num_levels) + " exceeds the " + std::to_string(max_levels) + " levels of the grid of " + name);
+}
 
-    std::vector<float> raw_vertices;
-    std::vector<uint8_t> raw_colors;
-    uint32_t num_vertices, num_colors, num_faces;
-    num_vertices = num_colors = num_faces = 0;
+// Reads one mesh. Throws std::runtime_error if the options don't fit the mapping or the mesh can't be read or mapped.
+void readMeshData(const std::string &input_filepath, double voxel_size, const std::string &mapping, const VoxelizerOptions &options, MeshData &mesh) {
 
-    num_vertices = input_file.request_properties_from_element("vertex", { "x", "y", "z" }, raw_vertices);
-    num_colors = input_file.request_properties_from_element("vertex", { "red", "green", "blue" }, raw_colors);
-    num_faces = input_file.request_properties_from_element("face", { "vertex_indices" }, faces, 3);
+    checkMapping(mapping, options);
 
-    input_file.read(ss);
+    if (!options.palette_filepath.empty() && mapping != "color")
+        throw std::runtime_error("--palette needs the color mapping");
 
-    vertices.resize(num_vertices);
-    classes.resize(num_vertices);
-    std::vector<Eigen::Vector3i> colors(num_vertices);
+    if (options.tile_size > 0 && options.tile_size % (1 << (options.num_levels - 1)) != 0)
+        throw std::runtime_error("--tiles must be a multiple of 2^(levels - 1) voxels");
 
-    int raw_vertices_i = 0;
-    int raw_colors_i = 0;
-    for (int i = 0; i < num_vertices; i++) {
+    if (options.num_shards > 0 && (options.tile_size > 0 || options.num_levels > 1 || options.octree))
+        throw std::runtime_error("--shard does not combine with --tiles, --levels or --format svo");
 
-        vertices[i][0] = raw_vertices[raw_vertices_i++];
-        vertices[i][1] = raw_vertices[raw_vertices_i++];
-        vertices[i][2] = raw_vertices[raw_vertices_i++];
+    if (options.global_grid && options.num_shards == 0)
+        throw std::runtime_error("--grid needs --shard");
 
-        colors[i][0] = raw_colors[raw_colors_i++];
-        colors[i][1] = raw_colors[raw_colors_i++];
-        colors[i][2] = raw_colors[raw_colors_i++];
+    if (!std::ifstream(input_filepath))
+        throw std::runtime_error("could not open " + input_filepath);
 
+    if (!options.palette_filepath.empty() && !ColorClassMapper::loadPalette(options.palette_filepath, mesh.colormap))
+        throw std::runtime_error("could not load palette " + options.palette_filepath);
+
+    mesh.filepath = input_filepath;
+    std::vector<uint32_t> *faces = (options.tile_size > 0) ? nullptr : &mesh.faces;
+
+    bool read = true;
+    if (mapping == "color") {
+        read = readPlyWithClass(input_filepath, mesh.vertices, mesh.min, mesh.max, faces, mesh.vertex_classes, mesh.colormap, options.num_threads);
+    } else if (mapping == "none") {
+        read = readPlyWithColor(input_filepath, mesh.vertices, mesh.min, mesh.max, faces, mesh.colors);
+    } else if (mapping == "labels") {
+        read = readPlyWithLabelProperties(input_filepath, mesh.vertices, mesh.min, mesh.max, faces, mesh.vertex_classes, mesh.colormap);
     }
 
-    for (const auto& color : colors) {
-        if(std::find(colormap.begin(), colormap.end(), color) == colormap.end())
-            colormap.push_back(color);
+    if (!read)
+        throw std::runtime_error("could not map the colors of " + input_filepath + " to classes");
+
+    getVoxelSpaceDimensions(voxel_size, mesh.min, mesh.max);
+
+    if (options.global_grid) {
+        if (!mesh.vertices.empty() && (((mesh.min + Eigen::Vector3f::Constant(voxel_size)).array() < options.grid_min.array()).any()
+                                       || ((mesh.max - Eigen::Vector3f::Constant(voxel_size)).array() > options.grid_max.array()).any()))
+            throw std::runtime_error("--grid does not enclose " + input_filepath);
+        mesh.min = options.grid_min;
+        mesh.max = options.grid_max;
     }
 
-    if (colormap.size() > 255) {
-        std::cerr << "Error: ClassyVoxelizer only supports mapping up to 255 colors to classes." << std::endl;
-        return false;
+    checkLevels(options.num_levels, ((mesh.max - mesh.min) / voxel_size).cast<int64_t>().maxCoeff(), input_filepath);
+}
+
+// Voxelizes tile by tile (see TiledVoxelizer) and hands every tile's levels to save under the tile's filepath, so
+// memory is bounded by a tile once the faces are binned. The faces are streamed from the mesh file through binFaces
+// in chunks of TILEDVOXELIZER_FACES_PER_CHUNK, never all in memory, and the vertices are freed after binning.
+// Merged outputs are concatenated level by level once every tile is written, and the tile files removed.
+template <typename Reducer, typename Payload, typename Saver>
+void voxelizeTiledAndSave(MeshData &mesh, std::vector<Payload> &vertex_payloads, float voxel_size, const VoxelizerOptions &options, bool dense, const DeferredSaver<Saver> &save) {
+
+    const std::string filepath = save.save.filepath;
+
+    TiledVoxelizer<Payload, Reducer> tiled_voxelizer(mesh.min, mesh.max, voxel_size, options.tile_size, filepath);
+    bool read = readPlyFaces(mesh.filepath, TILEDVOXELIZER_FACES_PER_CHUNK, [&](const std::vector<uint32_t> &faces) {
+        tiled_voxelizer.binFaces(mesh.vertices, faces, vertex_payloads);
+    });
+    if (!read)
+        throw std::runtime_error("could not read the faces of " + mesh.filepath);
+
+    std::vector<Eigen::Vector3f>().swap(mesh.vertices);
+    std::vector<Payload>().swap(vertex_payloads);
+
+    std::vector<std::string> tile_filepaths;
+    for (const Eigen::Vector3i &tile : tiled_voxelizer.getTiles(dense)) {
+        auto voxel_grid = tiled_voxelizer.voxelizeTile(tile, options.overlap_engine, options.separability, options.num_threads);
+        tile_filepaths.push_back(getTileFilepath(filepath, tile));
+        saveLevels(voxel_grid, options.num_levels, options.num_threads, save.withFilepath(tile_filepaths.back()));
     }
 
-    int vertex_class_i = 0;
-    for (const auto& color : colors) {
+    if (!options.merge_tiles || options.octree)
+        return;
+
+    unsigned int num_levels = options.num_levels;
+    save.writer([filepath, tile_filepaths, num_levels]() {
+        for (unsigned int level = 0; level < num_levels; level++) {
+            std::vector<std::string> level_filepaths;
+            for (const std::string &tile_filepath : tile_filepaths)
+                level_filepaths.push_back(getLevelFilepath(tile_filepath, level));
+            PLYStreamWriter::concatenate(level_filepaths, getLevelFilepath(filepath, level));
+            for (const std::string &level_filepath : level_filepaths)
+                remove(level_filepath.c_str());
+        }
+    });
+}
+
+// The faces whose voxels may reach the slices [slab.begin[2], slab.end[2]) of a grid starting at min_z, with the vertices
+// they use renumbered in order of first use, so the shard quantizes and looks up only those. One slice more on each
+// side covers faces lying on slice borders, like TiledVoxelizer::binFaces.
+template <typename Payload>
+void selectSlabFaces(const std::vector<Eigen::Vector3f> &vertices, const std::vector<uint32_t> &faces, const std::vector<Payload> &vertex_payloads, float min_z, float voxel_size, const VoxelBox &slab,
+                     std::vector<Eigen::Vector3f> &slab_vertices, std::vector<uint32_t> &slab_faces, std::vector<Payload> &slab_payloads) {
+
+    std::vector<uint32_t> slab_indices(vertices.size(), UINT32_MAX);
+
+    for (size_t i = 0; i + 2 < faces.size(); i += 3) {
 
-        int class_i;
-        for (class_i = 0; class_i < colormap.size(); class_i++) {
-            
-            if (colormap[class_i] == color) {
-                break;
+        float face_min_z = std::min(vertices[faces[i]][2], std::min(vertices[faces[i + 1]][2], vertices[faces[i + 2]][2]));
+        float face_max_z = std::max(vertices[faces[i]][2], std::max(vertices[faces[i + 1]][2], vertices[faces[i + 2]][2]));
+        int64_t first_slice = (int64_t) std::floor((face_min_z - min_z) / voxel_size) - 1;
+        int64_t last_slice = (int64_t) std::floor((face_max_z - min_z) / voxel_size) + 1;
+
+        if (last_slice < slab.begin[2] || first_slice >= slab.end[2])
+            continue;
+
+        for (int j = 0; j < 3; j++) {
+            uint32_t &slab_index = slab_indices[faces[i + j]];
+            if (slab_index == UINT32_MAX) {
+                slab_index = slab_vertices.size();
+                slab_vertices.push_back(vertices[faces[i + j]]);
+                slab_payloads.push_back(vertex_payloads[faces[i + j]]);
             }
+            slab_faces.push_back(slab_index);
         }
+    }
+}
+
+// Voxelizes the faces reaching the slab of slices of shard options.shard_index out of options.num_shards into a grid
+// restricted to the slab, and hands the write of its partial grid (see VoxelGrid::saveAsPartial) to writer.
+// Partial grids of all shards are merged with --merge-shards.
+template <typename Reducer, typename Payload>
+void voxelizeShardAndSave(const MeshData &mesh, const std::vector<Payload> &vertex_payloads, float voxel_size, const VoxelizerOptions &options, const std::string &filepath, const GridWriter &writer) {
+
+    typedef VoxelGrid<Payload, SparseVoxelStorage<Payload>> Grid;
+
+    Eigen::Vector3i voxels_per_dim = ((mesh.max - mesh.min) / voxel_size).cast<int>();
+    int64_t num_slices = voxels_per_dim[2];
+    VoxelBox slab(Eigen::Vector3i(0, 0, num_slices * options.shard_index / options.num_shards),
+                  Eigen::Vector3i(voxels_per_dim[0], voxels_per_dim[1], num_slices * (options.shard_index + 1) / options.num_shards));
+
+    std::vector<Eigen::Vector3f> slab_vertices;
+    std::vector<uint32_t> slab_faces;
+    std::vector<Payload> slab_payloads;
+    selectSlabFaces(mesh.vertices, mesh.faces, vertex_payloads, mesh.min[2], voxel_size, slab, slab_vertices, slab_faces, slab_payloads);
+
+    Grid voxel_grid = voxelizeMesh<Reducer, SparseVoxelStorage<Payload>>(slab_vertices, slab_faces, slab_payloads, mesh.min, mesh.max, voxel_size, options.overlap_engine, options.separability, options.num_threads, slab);
+
+    std::shared_ptr<Grid> grid = std::make_shared<Grid>(std::move(voxel_grid));
+    std::vector<Eigen::Vector3i> colormap = mesh.colormap;
+    writer([grid, filepath, colormap]() { grid->saveAsPartial(filepath, colormap); });
+}
 
-        classes[vertex_class_i++] = class_i+1;
+// Voxelizes one shard, tile by tile or in a single pass, as the options say
+template <typename Reducer, typename Payload, typename Saver>
+void voxelizeAndSaveMesh(MeshData &mesh, std::vector<Payload> &vertex_payloads, float voxel_size, bool dense, const VoxelizerOptions &options, const DeferredSaver<Saver> &save) {
+
+    if (options.num_shards > 0)
+        voxelizeShardAndSave<Reducer>(mesh, vertex_payloads, voxel_size, options, save.save.filepath, save.writer);
+    else if (options.tile_size > 0)
+        voxelizeTiledAndSave<Reducer>(mesh, vertex_payloads, voxel_size, options, dense, save);
+    else
+        voxelizeAndSave<Reducer>(mesh.vertices, mesh.faces, vertex_payloads, mesh.min, mesh.max, voxel_size, options.overlap_engine, options.separability, options.num_threads, options.sparse_storage, options.num_levels, save);
+}
+
+// Voxelizes a mesh read by readMeshData and hands the grid's write to writer. Tiled runs free the mesh on the way.
+void voxelizeMeshData(MeshData &mesh, const std::string &output_filepath, double voxel_size, const std::string &mapping, bool voxelize, const VoxelizerOptions &options, const GridWriter &writer) {
+
+    if (mapping == "color" || mapping == "labels") {
+        DeferredSaver<ClassGridSaver> save = {{output_filepath, mesh.colormap, voxelize, mapping == "labels", options.octree, options.num_threads}, writer};
+        if (options.merge == "majority")
+            voxelizeAndSaveMesh<MajorityReducer<uint8_t>>(mesh, mesh.vertex_classes, voxel_size, voxelize, options, save);
+        else
+            voxelizeAndSaveMesh<LastWriteReducer<uint8_t>>(mesh, mesh.vertex_classes, voxel_size, voxelize, options, save);
+    } else {
+        DeferredSaver<ColorGridSaver> save = {{output_filepath, voxelize, options.octree, options.num_threads}, writer};
+        if (options.merge == "average")
+            voxelizeAndSaveMesh<AveragingReducer<PackedColor>>(mesh, mesh.colors, voxel_size, voxelize, options, save);
+        else
+            voxelizeAndSaveMesh<LastWriteReducer<PackedColor>>(mesh, mesh.colors, voxel_size, voxelize, options, save);
     }
+}
 
-    return true;
+// Merges the partial grids of shards into one grid and saves it and its coarser levels in the storage selected on the
+// command line. make_save makes the saver from the class colors of the partial grids.
+template <typename Reducer, typename Payload, typename MakeSaver>
+void mergeAndSave(const std::vector<std::string> &partial_filepaths, const VoxelizerOptions &options, const MakeSaver &make_save) {
+
+    std::vector<Eigen::Vector3i> colormap;
 
+    if (options.sparse_storage) {
+        VoxelGrid<Payload, SparseVoxelStorage<Payload>> voxel_grid = Voxelizer<Payload, Reducer, SparseVoxelStorage<Payload>>::mergePartials(partial_filepaths, colormap);
+        checkLevels(options.num_levels, voxel_grid.getVoxelsPerDim().maxCoeff(), partial_filepaths[0]);
+        saveLevels(voxel_grid, options.num_levels, options.num_threads, make_save(colormap));
+    } else {
+        VoxelGrid<Payload, DenseVoxelStorage<Payload>> voxel_grid = Voxelizer<Payload, Reducer, DenseVoxelStorage<Payload>>::mergePartials(partial_filepaths, colormap);
+        checkLevels(options.num_levels, voxel_grid.getVoxelsPerDim().maxCoeff(), partial_filepaths[0]);
+        saveLevels(voxel_grid, options.num_levels, options.num_threads, make_save(colormap));
+    }
+}
+
+// Merges the partial grids written by --shard runs and saves the result like a run on the whole mesh
+void mergeShards(const std::vector<std::string> &partial_filepaths, const std::string &output_filepath, const std::string &mapping, bool voxelize, const VoxelizerOptions &options) {
+
+    checkMapping(mapping, options);
+
+    if (mapping == "color" || mapping == "labels") {
+        auto make_save = [&](const std::vector<Eigen::Vector3i> &colormap) {
+            return ClassGridSaver{output_filepath, colormap, voxelize, mapping == "labels", options.octree, options.num_threads};
+        };
+        if (options.merge == "majority")
+            mergeAndSave<MajorityReducer<uint8_t>, uint8_t>(partial_filepaths, options, make_save);
+        else
+            mergeAndSave<LastWriteReducer<uint8_t>, uint8_t>(partial_filepaths, options, make_save);
+    } else {
+        auto make_save = [&](const std::vector<Eigen::Vector3i> &colormap) {
+            return ColorGridSaver{output_filepath, voxelize, options.octree, options.num_threads};
+        };
+        if (options.merge == "average")
+            mergeAndSave<AveragingReducer<PackedColor>, PackedColor>(partial_filepaths, options, make_save);
+        else
+            mergeAndSave<LastWriteReducer<PackedColor>, PackedColor>(partial_filepaths, options, make_save);
+    }
+}
+
+// Throws std::runtime_error unless value is a positive number
+double parseVoxelSize(const std::string &value) {
+
+    std::istringstream field(value);
+    double voxel_size;
+    if (!(field >> voxel_size) || !field.eof() || voxel_size <= 0)
+        throw std::runtime_error("invalid voxel size: " + value);
+
+    return voxel_size;
 }
 
-bool readPlyWithColor(std::string filepath, std::vector<Eigen::Vector3f> &vertices, std::vector<uint32_t> &faces, std::vector<Eigen::Vector3i> &colors) {
+// Reads, voxelizes and saves one mesh on the calling thread
+void voxelizeFile(const std::string &input_filepath, const std::string &output_filepath, double voxel_size, const std::string &mapping, bool voxelize, const VoxelizerOptions &options) {
 
-    std::ifstream ss(filepath, std::ios::binary);
+    TRACE_SPAN_DETAIL("file", input_filepath);
 
-    tinyply::PlyFile input_file(ss);
+    MeshData mesh;
+    readMeshData(input_filepath, voxel_size, mapping, options, mesh);
 
-    std::vector<float> raw_vertices;
-    std::vector<uint8_t> raw_colors;
-    uint32_t num_vertices, num_colors, num_faces;
-    num_vertices = num_colors = num_faces = 0;
+    GridWriter write_now = [](std::function<void()> write) { write(); };
+    voxelizeMeshData(mesh, output_filepath, voxel_size, mapping, voxelize, options, write_now);
+}
 
-    num_vertices = input_file.request_properties_from_element("vertex", { "x", "y", "z" }, raw_vertices);
-    num_colors = input_file.request_properties_from_element("vertex", { "red", "green", "blue" }, raw_colors);
-    num_faces = input_file.request_properties_from_element("face", { "vertex_indices" }, faces, 3);
+// One line of a batch manifest: <input_filename> <output_filename> <voxel_size> <color_mapping> <voxelize>
+struct BatchJob {
+    int line_i;
+    std::string input_filepath;
+    std::string output_filepath;
+    double voxel_size;
+    std::string mapping;
+    std::string voxelize;
+    uint64_t input_size;
+    double read_seconds;
+    double voxelize_seconds;
+};
+
+// Reads the jobs of a manifest, skipping blank lines and lines starting with '#'. Malformed lines become jobs
+// with an empty output, so they are reported with the other failures.
+bool readManifest(const std::string &filepath, std::vector<BatchJob> &jobs) {
+
+    std::ifstream manifest_file(filepath);
+    if (!manifest_file)
+        return false;
 
-    input_file.read(ss);
+    std::string line;
+    int line_i = 0;
+    while (std::getline(manifest_file, line)) {
 
-    vertices.resize(num_vertices);
-    colors.resize(num_vertices);
+        line_i++;
+        std::istringstream fields(line);
+        BatchJob job = {line_i};
+        std::string extra;
 
-    int raw_vertices_i = 0;
-    int raw_colors_i = 0;
-    for (int i = 0; i < num_vertices; i++) {
+        if (!(fields >> job.input_filepath) || job.input_filepath[0] == '#')
+            continue;
 
-        vertices[i][0] = raw_vertices[raw_vertices_i++];
-        vertices[i][1] = raw_vertices[raw_vertices_i++];
-        vertices[i][2] = raw_vertices[raw_vertices_i++];
+        if (!(fields >> job.output_filepath >> job.voxel_size >> job.mapping >> job.voxelize) || (fields >> extra))
+            job.output_filepath.clear();
 
-        colors[i][0] = raw_colors[raw_colors_i++];
-        colors[i][1] = raw_colors[raw_colors_i++];
-        colors[i][2] = raw_colors[raw_colors_i++];
+        std::ifstream input_file(job.input_filepath, std::ios::binary | std::ios::ate);
+        job.input_size = input_file ? (uint64_t) input_file.tellg() : 0;
 
+        jobs.push_back(job);
     }
 
     return true;
+}
 
+// Seconds since start
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 }
 
-void getVoxelSpaceDimensions(const std::vector<Eigen::Vector3f> &vertices, const double voxel_size, Eigen::Vector3f &min, Eigen::Vector3f &max) {
+// Voxelizes every job of the manifest in a pipeline: one thread reads the meshes, largest input first, options.num_jobs
+// workers voxelize them and one thread writes the finished grids, so disk I/O overlaps with voxelization. The stages
+// hand over through queues of options.queue_depth meshes and grids, which bounds the memory of the pipeline.
+// A failing job is reported and the batch goes on. Returns the number of failed jobs.
+int runBatch(const std::string &manifest_filepath, const VoxelizerOptions &options) {
 
-    Eigen::Vector3f centroid(0,0,0);
+    std::vector<BatchJob> jobs;
+    if (!readManifest(manifest_filepath, jobs)) {
+        std::cout << "Could not read manifest " << manifest_filepath << std::endl;
+        return 1;
+    }
 
-    for (const Eigen::Vector3f& vertex : vertices)
-        centroid += vertex;
+    std::stable_sort(jobs.begin(), jobs.end(), [](const BatchJob &a, const BatchJob &b) { return a.input_size > b.input_size; });
 
-    centroid /= vertices.size();
+    struct ReadMesh {
+        size_t job_i;
+        std::unique_ptr<MeshData> mesh;
+    };
 
-    max = centroid;
-    min = centroid;
+    // A grid or tile of a job, or the job's end, which carries the error of a failed voxelization
+    struct GridWrite {
+        size_t job_i;
+        std::function<void()> write;
+        bool last;
+        std::string error;
+    };
 
-    for (const Eigen::Vector3f& vertex : vertices) {
+    BoundedQueue<ReadMesh> read_meshes(options.queue_depth);
+    BoundedQueue<GridWrite> grid_writes(options.queue_depth);
 
-        if ((vertex[0] - centroid[0]) > (max[0] - centroid[0]))
-            max[0] = vertex[0];
+    std::mutex report_mutex;
+    size_t num_done = 0;
+    int num_failed = 0;
 
-        if ((vertex[1] - centroid[1]) > (max[1] - centroid[1]))
-            max[1] = vertex[1];
+    auto report = [&](size_t job_i, double write_seconds, const std::string &error) {
 
-        if ((vertex[2] - centroid[2]) > (max[2] - centroid[2]))
-            max[2] = vertex[2];
+        const BatchJob &job = jobs[job_i];
 
-        if ((vertex[0] - centroid[0]) < (min[0] - centroid[0]))
-            min[0] = vertex[0];
+        std::lock_guard<std::mutex> lock(report_mutex);
+        std::cout << "[" << ++num_done << "/" << jobs.size() << "] line " << job.line_i << ": " << job.input_filepath;
+        if (error.empty()) {
+            std::cout << " -> " << job.output_filepath << " read " << job.read_seconds << " s, voxelized " << job.voxelize_seconds
+                      << " s, written " << write_seconds << " s" << std::endl;
+        } else {
+            std::cout << " FAILED: " << error << std::endl;
+            num_failed++;
+        }
+    };
 
-        if ((vertex[1] - centroid[1]) < (min[1] - centroid[1]))
-            min[1] = vertex[1];
+    auto reader = [&]() {
 
-        if ((vertex[2] - centroid[2]) < (min[2] - centroid[2]))
-            min[2] = vertex[2];
+        TRACE_THREAD_NAME("reader");
 
-    }
+        for (size_t job_i = 0; job_i < jobs.size(); job_i++) {
 
-    max += Eigen::Vector3f(voxel_size, voxel_size, voxel_size);
-    min -= Eigen::Vector3f(voxel_size, voxel_size, voxel_size);
+            BatchJob &job = jobs[job_i];
+            auto start = std::chrono::steady_clock::now();
+            ReadMesh read_mesh = {job_i, std::unique_ptr<MeshData>(new MeshData())};
 
-}
+            try {
+                if (job.output_filepath.empty())
+                    throw std::runtime_error("expected <input_filename> <output_filename> <voxel_size> <color_mapping> <voxelize>");
+                readMeshData(job.input_filepath, job.voxel_size, job.mapping, options, *read_mesh.mesh);
+            } catch (const std::exception &e) {
+                report(job_i, 0, e.what());
+                continue;
+            }
+
+            job.read_seconds = secondsSince(start);
+            read_meshes.push(std::move(read_mesh));
+        }
+
+        read_meshes.close();
+    };
+
+    auto voxelizer = [&]() {
+
+        TRACE_THREAD_NAME("voxelizer");
+
+        ReadMesh read_mesh;
+        while (read_meshes.pop(read_mesh)) {
+
+            BatchJob &job = jobs[read_mesh.job_i];
+            TRACE_SPAN_DETAIL("file", job.input_filepath);
+            auto start = std::chrono::steady_clock::now();
+
+            // every level and tile goes to the writer once it is done, so tiled jobs hold no more than the queue's
+            // grids; the writer reports the job at its last write
+            GridWriter writer = [&](std::function<void()> write) { grid_writes.push({read_mesh.job_i, write, false, ""}); };
+            std::string error;
+
+            try {
+                voxelizeMeshData(*read_mesh.mesh, job.output_filepath, job.voxel_size, job.mapping, job.voxelize == "true", options, writer);
+            } catch (const std::exception &e) {
+                error = e.what();
+            }
+
+            job.voxelize_seconds = secondsSince(start);
+            read_mesh.mesh.reset();
+
+            grid_writes.push({read_mesh.job_i, nullptr, true, error});
+        }
+    };
+
+    auto writer = [&]() {
+
+        TRACE_THREAD_NAME("writer");
 
+        // write seconds and first error of the jobs under way; writes after an error are skipped
+        struct JobWrites {
+            double seconds = 0;
+            std::string error;
+        };
+        std::map<size_t, JobWrites> job_writes;
+
+        GridWrite grid_write;
+        while (grid_writes.pop(grid_write)) {
+
+            JobWrites &writes = job_writes[grid_write.job_i];
+            auto start = std::chrono::steady_clock::now();
+
+            if (writes.error.empty() && grid_write.write) {
+                try {
+                    grid_write.write();
+                } catch (const std::exception &e) {
+                    writes.error = e.what();
+                }
+            }
+
+            grid_write.write = nullptr;
+            writes.seconds += secondsSince(start);
+
+            if (grid_write.last) {
+                report(grid_write.job_i, writes.seconds, grid_write.error.empty() ? writes.error : grid_write.error);
+                job_writes.erase(grid_write.job_i);
+            }
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::thread reader_thread(reader);
+    std::thread writer_thread(writer);
+
+    unsigned int num_voxelizers = std::min<size_t>(resolveNumThreads(options.num_jobs), std::max<size_t>(1, jobs.size()));
+    std::vector<std::thread> voxelizer_threads;
+    for (unsigned int i = 0; i < num_voxelizers; i++)
+        voxelizer_threads.emplace_back(voxelizer);
+
+    reader_thread.join();
+    for (auto &thread : voxelizer_threads)
+        thread.join();
+    grid_writes.close();
+    writer_thread.join();
+
+    std::cout << jobs.size() - num_failed << " of " << jobs.size() << " files voxelized in " << secondsSince(start) << " s" << std::endl;
+
+    return num_failed;
+}
 
 int main (int argc, char* argv[]) {
     
-    std::string usage_message = "\nUsage:\n\n./classyvoxelizer <input_filename> <output_filename> <voxel_size> <color_mapping: color|labels|none> <voxelize: true|false>";
-    
-    if (argc < 6) {
+    std::string usage_message = "\nUsage:\n\n./classyvoxelizer <input_filename> <output_filename> <voxel_size> <color_mapping: color|labels|none> <voxelize: true|false> [options]"
+                                "\n./classyvoxelizer --batch <manifest> [options]"
+                                "\n./classyvoxelizer --merge-shards <output_filename> <color_mapping> <voxelize> <partial_grid>... [options]"
+                                "\n\nA manifest has one \"<input_filename> <output_filename> <voxel_size> <color_mapping> <voxelize>\" per line."
+                                "\n\nOptions:\n\n"
+                                "  --threads <n>             voxelize on n threads (0: all hardware threads, default: 1)\n"
+                                "  --jobs <n>                with --batch: voxelize n files at a time (0: all hardware threads, default: 0)\n"
+                                "  --queue <n>               with --batch: up to n read meshes and n voxelized grids wait between the stages (default: 2)\n"
+                                "  --engine <split|sat>      split faces into voxel-sized pieces (default) or cover them with triangle/voxel overlap tests\n"
+                                "  --separating <6|26>       with --engine sat: only the overlapped voxels of a thin 6- or 26-separating surface\n"
+                                "  --storage <dense|sparse>  keep the whole voxel grid in memory (default) or only 8x8x8 bricks the mesh touches\n"
+                                "  --format <ply|svo>        save point clouds (default) or sparse voxel octrees of the occupied voxels\n"
+                                "  --tiles <n>               voxelize tiles of n^3 voxels one at a time, binning the faces to disk first\n"
+                                "  --tile-output <merged|separate>  with --tiles: merge the tiles into the output (default, not for svo)\n"
+                                "                            or save every tile as <output>_tile<i>_<j>_<k>.ply\n"
+                                "  --shard <i> <n>           voxelize only slab i of n of the grid's slices and save it as a partial grid\n"
+                                "                            to <output_filename>, to be merged with --merge-shards\n"
+                                "  --grid <min_x> <min_y> <min_z> <max_x> <max_y> <max_z>  with --shard: the grid of all shards\n"
+                                "                            (default: the bounding box of the mesh padded by a voxel)\n"
+                                "  --merge <last|majority|average>  voxels hit by several faces keep the last payload written (default),\n"
+                                "                            the most frequent class (color, labels) or the mean color (none)\n"
+                                "  --levels <n>              also save n - 1 coarser levels, each at twice the voxel size of the one before,\n"
+                                "                            as <output>_level<l>.ply (default: 1, at most 22 and the levels of the grid)\n"
+                                "  --palette <file>          with the color mapping: \"red green blue\" per line, line i is class i + 1\n"
+                                "  --stats <file>            write the seconds spent per phase and counters of the run to file as JSON\n"
+                                "  --trace <file>            write the spans every thread ran to file as Chrome trace JSON, for Perfetto";
+
+    bool batch = (argc >= 3 && std::string(argv[1]) == "--batch");
+    bool merge_shards = (argc >= 6 && std::string(argv[1]) == "--merge-shards");
+
+    // partial grids run up to the first option
+    int first_option = batch ? 3 : 6;
+    std::vector<std::string> partial_filepaths;
+    if (merge_shards) {
+        for (first_option = 5; first_option < argc && std::string(argv[first_option]).compare(0, 2, "--") != 0; first_option++)
+            partial_filepaths.push_back(argv[first_option]);
+    }
+
+    if (argc < 6 && !batch) {
         std::cout << usage_message << std::endl;
         return 0;
     }
 
-    std::string input_filepath = argv[1];
-    std::string output_filepath = argv[2];
-    double voxel_size = std::stod(argv[3]);
+    VoxelizerOptions options;
+    std::string unknown_option = parseOptions(argc, argv, first_option, options);
+    if (!unknown_option.empty()) {
+        std::cout << "Unknown option or invalid value: " << unknown_option << std::endl << usage_message << std::endl;
+        return 1;
+    }
 
-    std::vector<Eigen::Vector3f> vertices;
-    std::vector<uint32_t> faces;
-    std::vector<uint8_t> vertex_classes;
-    std::vector<Eigen::Vector3i> colormap;
-    std::vector<Eigen::Vector3i> colors;
+    if (!options.stats_filepath.empty()) {
+#ifdef CLASSYVOXELIZER_STATS
+        Stats::enable();
+#else
+        std::cout << "--stats needs a build with the CLASSYVOXELIZER_STATS option on" << std::endl;
+        return 1;
+#endif
+    }
 
-    if (std::string(argv[4]) == "color") {
-        readPlyWithClass(input_filepath, vertices, faces, vertex_classes, colormap);
-    } else if (std::string(argv[4]) == "none") {
-        readPlyWithColor(input_filepath, vertices, faces, colors);
-    } else if (std::string(argv[4]) == "labels") {
-        readPlyWithLabelProperties(input_filepath, vertices, faces, vertex_classes, colormap);
+    if (!options.trace_filepath.empty()) {
+#ifdef CLASSYVOXELIZER_TRACE
+        Trace::enable();
+        Trace::nameThread("main");
+#else
+        std::cout << "--trace needs a build with the CLASSYVOXELIZER_TRACE option on" << std::endl;
+        return 1;
+#endif
     }
 
-    bool voxelize = (std::string(argv[5]) == "true") ? true : false;
+    int status = 0;
 
-    Eigen::Vector3f min;
-    Eigen::Vector3f max;
-    getVoxelSpaceDimensions(vertices, voxel_size, min, max);
+    if (batch) {
+        status = (runBatch(argv[2], options) == 0) ? 0 : 1;
+    } else if (merge_shards) {
+        try {
+            mergeShards(partial_filepaths, argv[2], argv[3], std::string(argv[4]) == "true", options);
+        } catch (const std::runtime_error &e) {
+            std::cout << e.what() << std::endl;
+            status = 1;
+        }
+    } else {
+        try {
+            voxelizeFile(argv[1], argv[2], parseVoxelSize(argv[3]), argv[4], std::string(argv[5]) == "true", options);
+        } catch (const std::runtime_error &e) {
+            std::cout << e.what() << std::endl;
+            status = 1;
+        }
+    }
 
-    if (std::string(argv[4]) == "color") {
-        MultiClassVoxelGrid voxelgrid = MultiClassVoxelizer::voxelize(vertices, faces, vertex_classes, min, max, voxel_size);
-        voxelgrid.saveAsPLY(output_filepath, colormap, voxelize);
-    } else if (std::string(argv[4]) == "none") {
-        ColoredVoxelGrid voxelgrid = ColoredVoxelizer::voxelize(vertices, faces, colors, min, max, voxel_size);
-        voxelgrid.saveAsPLY(output_filepath, voxelize);
-    } else if (std::string(argv[4]) == "labels") {
-        MultiClassVoxelGrid voxelgrid = MultiClassVoxelizer::voxelize(vertices, faces, vertex_classes, min, max, voxel_size);
-        voxelgrid.saveAsPLYWithLabelProperties(output_filepath, colormap, voxelize);
+    try {
+        if (!options.stats_filepath.empty())
+            Stats::save(options.stats_filepath);
+        if (!options.trace_filepath.empty())
+            Trace::save(options.trace_filepath);
+    } catch (const std::runtime_error &e) {
+        std::cout << e.what() << std::endl;
+        return 1;
     }
 
-    return 0;
-}
\ No newline at end of file
+    return status;
+}
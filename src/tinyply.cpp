@@ -4,8 +4,21 @@
 // Authored in 2015 by Dimitri Diakopoulos (http://www.dimitridiakopoulos.com)
 // https://github.com/ddiakopoulos/tinyply
 
+#include <thread>
+#include <cmath>
+#include <cfloat>
+#include <cstdlib>
+
 #include "tinyply.h"
 
+#if defined(__unix__) || defined(__APPLE__)
+#define TINYPLY_MMAP
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 using namespace tinyply;
 using namespace std;
 
@@ -105,71 +118,224 @@ void PlyFile::read_header_property(std::istream & is)
     get_elements().back().properties.emplace_back(is);
 }
 
-size_t PlyFile::skip_property_binary(const PlyProperty & property, std::istream & is)
+//////////////////////
+// Decoding kernels //
+//////////////////////
+
+namespace
 {
-    static std::vector<char> skip(PropertyTable[property.propertyType].stride);
-    if (property.isList)
+    typedef void (*BinaryKernel)(uint8_t * dest, const char * src, size_t count);
+    typedef void (*AsciiKernel)(uint8_t * dest, std::istream & is, size_t count);
+    typedef size_t (*CountKernel)(const char * src);
+
+    template<size_t Size> struct BitsOfSize;
+    template<> struct BitsOfSize<1> { typedef uint8_t type; };
+    template<> struct BitsOfSize<2> { typedef uint16_t type; };
+    template<> struct BitsOfSize<4> { typedef uint32_t type; };
+    template<> struct BitsOfSize<8> { typedef uint64_t type; };
+
+    template<typename T, bool Swapped>
+    inline T load_binary(const char * src)
     {
-		size_t listSize = 0;
-		size_t dummyCount = 0;
-        read_property_binary(property.listType, &listSize, dummyCount, is);
-        for (size_t i = 0; i < listSize; ++i) is.read(skip.data(), PropertyTable[property.propertyType].stride);
-        return listSize;
+        typename BitsOfSize<sizeof(T)>::type bits;
+        std::memcpy(&bits, src, sizeof(T));
+        if (Swapped) bits = endian_swap(bits);
+        T value;
+        std::memcpy(&value, &bits, sizeof(T));
+        return value;
     }
-    else
+
+    template<typename T>
+    void copy_binary(uint8_t * dest, const char * src, size_t count)
     {
-        is.read(skip.data(), PropertyTable[property.propertyType].stride);
-        return 0;
+        std::memcpy(dest, src, count * sizeof(T));
     }
-}
 
-void PlyFile::skip_property_ascii(const PlyProperty & property, std::istream & is)
-{
-    std::string skip;
-    if (property.isList)
+    template<typename T>
+    void copy_binary_swapped(uint8_t * dest, const char * src, size_t count)
     {
-        int listSize;
-        is >> listSize;
-        for (int i = 0; i < listSize; ++i) is >> skip;
+        for (size_t i = 0; i < count; ++i)
+        {
+            T value = load_binary<T, true>(src + i * sizeof(T));
+            std::memcpy(dest + i * sizeof(T), &value, sizeof(T));
+        }
     }
-    else is >> skip;
-}
 
-void PlyFile::read_property_binary(PlyProperty::Type t, void * dest, size_t & destOffset, std::istream & is)
-{
-    static std::vector<char> src(PropertyTable[t].stride);
-    is.read(src.data(), PropertyTable[t].stride);
+    template<typename T, bool Swapped>
+    size_t decode_count(const char * src)
+    {
+        return size_t(load_binary<T, Swapped>(src));
+    }
 
-    switch (t)
+    // 8-bit values are read as 32-bit integers so that they are not taken for characters
+    template<typename T, typename Parsed>
+    void parse_ascii_stream(uint8_t * dest, std::istream & is, size_t count)
     {
-        case PlyProperty::Type::INT8:       ply_cast<int8_t>(dest, src.data(), isBigEndian);        break;
-        case PlyProperty::Type::UINT8:      ply_cast<uint8_t>(dest, src.data(), isBigEndian);       break;
-        case PlyProperty::Type::INT16:      ply_cast<int16_t>(dest, src.data(), isBigEndian);       break;
-        case PlyProperty::Type::UINT16:     ply_cast<uint16_t>(dest, src.data(), isBigEndian);      break;
-        case PlyProperty::Type::INT32:      ply_cast<int32_t>(dest, src.data(), isBigEndian);       break;
-        case PlyProperty::Type::UINT32:     ply_cast<uint32_t>(dest, src.data(), isBigEndian);      break;
-        case PlyProperty::Type::FLOAT32:    ply_cast_float<float>(dest, src.data(), isBigEndian);   break;
-        case PlyProperty::Type::FLOAT64:    ply_cast_double<double>(dest, src.data(), isBigEndian); break;
-        case PlyProperty::Type::INVALID:    throw std::invalid_argument("invalid ply property");
+        for (size_t i = 0; i < count; ++i)
+        {
+            Parsed parsed;
+            is >> parsed;
+            T value = T(parsed);
+            if (dest) std::memcpy(dest + i * sizeof(T), &value, sizeof(T));
+        }
     }
-    destOffset += PropertyTable[t].stride;
-}
 
-void PlyFile::read_property_ascii(PlyProperty::Type t, void * dest, size_t & destOffset, std::istream & is)
-{
-    switch (t)
+    BinaryKernel binary_kernel(PlyProperty::Type t, bool swapped)
     {
-        case PlyProperty::Type::INT8:       *((int8_t *)dest) = ply_read_ascii<int32_t>(is);        break;
-        case PlyProperty::Type::UINT8:      *((uint8_t *)dest) = ply_read_ascii<uint32_t>(is);      break;
-        case PlyProperty::Type::INT16:      ply_cast_ascii<int16_t>(dest, is);                      break;
-        case PlyProperty::Type::UINT16:     ply_cast_ascii<uint16_t>(dest, is);                     break;
-        case PlyProperty::Type::INT32:      ply_cast_ascii<int32_t>(dest, is);                      break;
-        case PlyProperty::Type::UINT32:     ply_cast_ascii<uint32_t>(dest, is);                     break;
-        case PlyProperty::Type::FLOAT32:    ply_cast_ascii<float>(dest, is);                        break;
-        case PlyProperty::Type::FLOAT64:    ply_cast_ascii<double>(dest, is);                       break;
-        case PlyProperty::Type::INVALID:    throw std::invalid_argument("invalid ply property");
+        switch (t)
+        {
+            case PlyProperty::Type::INT8:       return &copy_binary<int8_t>;
+            case PlyProperty::Type::UINT8:      return &copy_binary<uint8_t>;
+            case PlyProperty::Type::INT16:      return swapped ? &copy_binary_swapped<int16_t> : &copy_binary<int16_t>;
+            case PlyProperty::Type::UINT16:     return swapped ? &copy_binary_swapped<uint16_t> : &copy_binary<uint16_t>;
+            case PlyProperty::Type::INT32:      return swapped ? &copy_binary_swapped<int32_t> : &copy_binary<int32_t>;
+            case PlyProperty::Type::UINT32:     return swapped ? &copy_binary_swapped<uint32_t> : &copy_binary<uint32_t>;
+            case PlyProperty::Type::FLOAT32:    return swapped ? &copy_binary_swapped<float> : &copy_binary<float>;
+            case PlyProperty::Type::FLOAT64:    return swapped ? &copy_binary_swapped<double> : &copy_binary<double>;
+            default:                            throw std::invalid_argument("invalid ply property");
+        }
+    }
+
+    CountKernel count_kernel(PlyProperty::Type t, bool swapped)
+    {
+        switch (t)
+        {
+            case PlyProperty::Type::INT8:       return &decode_count<int8_t, false>;
+            case PlyProperty::Type::UINT8:      return &decode_count<uint8_t, false>;
+            case PlyProperty::Type::INT16:      return swapped ? &decode_count<int16_t, true> : &decode_count<int16_t, false>;
+            case PlyProperty::Type::UINT16:     return swapped ? &decode_count<uint16_t, true> : &decode_count<uint16_t, false>;
+            case PlyProperty::Type::INT32:      return swapped ? &decode_count<int32_t, true> : &decode_count<int32_t, false>;
+            case PlyProperty::Type::UINT32:     return swapped ? &decode_count<uint32_t, true> : &decode_count<uint32_t, false>;
+            default:                            throw std::invalid_argument("invalid ply list count type");
+        }
+    }
+
+    AsciiKernel ascii_kernel(PlyProperty::Type t)
+    {
+        switch (t)
+        {
+            case PlyProperty::Type::INT8:       return &parse_ascii_stream<int8_t, int32_t>;
+            case PlyProperty::Type::UINT8:      return &parse_ascii_stream<uint8_t, uint32_t>;
+            case PlyProperty::Type::INT16:      return &parse_ascii_stream<int16_t, int16_t>;
+            case PlyProperty::Type::UINT16:     return &parse_ascii_stream<uint16_t, uint16_t>;
+            case PlyProperty::Type::INT32:      return &parse_ascii_stream<int32_t, int32_t>;
+            case PlyProperty::Type::UINT32:     return &parse_ascii_stream<uint32_t, uint32_t>;
+            case PlyProperty::Type::FLOAT32:    return &parse_ascii_stream<float, float>;
+            case PlyProperty::Type::FLOAT64:    return &parse_ascii_stream<double, double>;
+            default:                            throw std::invalid_argument("invalid ply property");
+        }
+    }
+
+    template<typename T>
+    inline T load_value(const uint8_t * src)
+    {
+        T value;
+        std::memcpy(&value, src, sizeof(T));
+        return value;
+    }
+
+    template<typename From, typename To>
+    void convert_from(const uint8_t * src, uint8_t * dest, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            To value = To(load_value<From>(src + i * sizeof(From)));
+            std::memcpy(dest + i * sizeof(To), &value, sizeof(To));
+        }
+    }
+
+    template<typename From>
+    void convert_from(const uint8_t * src, PlyProperty::Type to, uint8_t * dest, size_t count)
+    {
+        switch (to)
+        {
+            case PlyProperty::Type::INT8:       convert_from<From, int8_t>(src, dest, count);      break;
+            case PlyProperty::Type::UINT8:      convert_from<From, uint8_t>(src, dest, count);     break;
+            case PlyProperty::Type::INT16:      convert_from<From, int16_t>(src, dest, count);     break;
+            case PlyProperty::Type::UINT16:     convert_from<From, uint16_t>(src, dest, count);    break;
+            case PlyProperty::Type::INT32:      convert_from<From, int32_t>(src, dest, count);     break;
+            case PlyProperty::Type::UINT32:     convert_from<From, uint32_t>(src, dest, count);    break;
+            case PlyProperty::Type::FLOAT32:    convert_from<From, float>(src, dest, count);       break;
+            case PlyProperty::Type::FLOAT64:    convert_from<From, double>(src, dest, count);      break;
+            default:                            throw std::invalid_argument("invalid ply property");
+        }
+    }
+
+    // Converts count host-order values of type from to values of type to, for raw destinations of another type
+    void convert_values(PlyProperty::Type from, const uint8_t * src, PlyProperty::Type to, uint8_t * dest, size_t count)
+    {
+        switch (from)
+        {
+            case PlyProperty::Type::INT8:       convert_from<int8_t>(src, to, dest, count);    break;
+            case PlyProperty::Type::UINT8:      convert_from<uint8_t>(src, to, dest, count);   break;
+            case PlyProperty::Type::INT16:      convert_from<int16_t>(src, to, dest, count);   break;
+            case PlyProperty::Type::UINT16:     convert_from<uint16_t>(src, to, dest, count);  break;
+            case PlyProperty::Type::INT32:      convert_from<int32_t>(src, to, dest, count);   break;
+            case PlyProperty::Type::UINT32:     convert_from<uint32_t>(src, to, dest, count);  break;
+            case PlyProperty::Type::FLOAT32:    convert_from<float>(src, to, dest, count);     break;
+            case PlyProperty::Type::FLOAT64:    convert_from<double>(src, to, dest, count);    break;
+            default:                            throw std::invalid_argument("invalid ply property");
+        }
+    }
+
+    // Type the values of a property are stored as at its destination
+    PlyProperty::Type destination_type(const DataCursor * cursor, PlyProperty::Type propertyType)
+    {
+        return (cursor && cursor->type != PlyProperty::Type::INVALID) ? cursor->type : propertyType;
+    }
+
+    // One property of an element, with its kernels picked once. Consecutive scalar properties that share a
+    // destination and a type are merged into one step of count values.
+    struct DecodeStep
+    {
+        DataCursor * cursor;        // null for properties that are skipped
+        PlyProperty::Type type;
+        bool isList;
+        size_t count;               // values per record, for scalars and lists of fixed length
+        size_t stride;              // bytes per value
+        size_t srcOffset;           // offset in the record of the values, for elements of fixed record size
+        size_t listStride;
+        BinaryKernel binary;
+        AsciiKernel ascii;
+        CountKernel binaryCount;
+        PlyProperty::Type destType; // converted to once decoded, if not type
+        size_t destStride;
+    };
+
+    const size_t DECODE_CHUNK_BYTES = 1 << 16;
+    // Records decoded before they are handed to a request_decoded_ranges callback
+    const size_t DECODED_RANGE_RECORDS = 1 << 12;
+
+    // Decodes count scalar values of a step into dest, converting them to the destination's type
+    inline void decode_binary(const DecodeStep & step, uint8_t * dest, const char * src, size_t count)
+    {
+        if (step.destType == step.type)
+        {
+            step.binary(dest, src, count);
+            return;
+        }
+        uint8_t value[8];
+        for (size_t i = 0; i < count; ++i)
+        {
+            step.binary(value, src + i * step.stride, 1);
+            convert_values(step.type, value, step.destType, dest + i * step.destStride, 1);
+        }
+    }
+
+    inline void decode_ascii(const DecodeStep & step, uint8_t * dest, std::istream & is, size_t count)
+    {
+        if (!dest || step.destType == step.type)
+        {
+            step.ascii(dest, is, count);
+            return;
+        }
+        uint8_t value[8];
+        for (size_t i = 0; i < count; ++i)
+        {
+            step.ascii(value, is, 1);
+            convert_values(step.type, value, step.destType, dest + i * step.destStride, 1);
+        }
     }
-    destOffset += PropertyTable[t].stride;
 }
 
 void PlyFile::write_property_ascii(PlyProperty::Type t, std::ostream & os, uint8_t * src, size_t & srcOffset)
@@ -201,6 +367,165 @@ void PlyFile::read(std::istream & is)
     read_internal(is);
 }
 
+void PlyFile::read(std::istream & is, const std::string & filepath)
+{
+    const uint16_t endianProbe = 1;
+    bool hostLittleEndian = *reinterpret_cast<const uint8_t *>(&endianProbe) == 1;
+
+#ifdef TINYPLY_MMAP
+    std::streamoff headerSize = is.tellg();
+    bool mappable = chunkRequests.empty() && (isBinary ? (!isBigEndian && hostLittleEndian) : true);
+    int fd = (mappable && headerSize > 0) ? open(filepath.c_str(), O_RDONLY) : -1;
+    if (fd >= 0)
+    {
+        struct stat fileStat;
+        void * mapping = (fstat(fd, &fileStat) == 0 && fileStat.st_size > headerSize) ? mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+        close(fd);
+        if (mapping != MAP_FAILED)
+        {
+            const uint8_t * data = static_cast<const uint8_t *>(mapping);
+            bool mapped = isBinary ? read_mapped(data + headerSize, fileStat.st_size - headerSize)
+                                   : read_mapped_ascii(reinterpret_cast<const char *>(data) + headerSize, fileStat.st_size - headerSize);
+            munmap(mapping, fileStat.st_size);
+            if (mapped) return;
+        }
+    }
+#endif
+
+    read_internal(is);
+}
+
+// Plans every element's record layout first and only copies once the whole file is known to fit it,
+// so a false return leaves all cursors untouched for the stream path.
+bool PlyFile::read_mapped(const uint8_t * data, size_t dataSize)
+{
+    struct PropertyLayout { size_t offset; size_t size; size_t listSize; };
+    std::vector<std::vector<PropertyLayout>> layouts;
+    std::vector<size_t> recordSizes;
+
+    size_t elementBegin = 0;
+    for (auto & element : get_elements())
+    {
+        std::vector<PropertyLayout> layout;
+        size_t recordSize = 0;
+        for (auto & property : element.properties)
+        {
+            size_t stride = PropertyTable[property.propertyType].stride;
+            if (stride == 0) return false;
+            if (!property.isList)
+            {
+                layout.push_back({ recordSize, stride, 0 });
+                recordSize += stride;
+                continue;
+            }
+
+            size_t countStride = PropertyTable[property.listType].stride;
+            if (countStride == 0 || element.size == 0 || elementBegin + recordSize + countStride > dataSize) return false;
+            size_t listSize = 0;
+            switch (property.listType)
+            {
+                case PlyProperty::Type::INT8: case PlyProperty::Type::UINT8:    listSize = data[elementBegin + recordSize]; break;
+                case PlyProperty::Type::INT16: case PlyProperty::Type::UINT16:  listSize = *reinterpret_cast<const uint16_t *>(data + elementBegin + recordSize); break;
+                case PlyProperty::Type::INT32: case PlyProperty::Type::UINT32:  listSize = *reinterpret_cast<const uint32_t *>(data + elementBegin + recordSize); break;
+                default: return false;
+            }
+            layout.push_back({ recordSize, countStride, listSize });
+            recordSize += countStride + listSize * stride;
+        }
+
+        if (recordSize == 0 || element.size > (dataSize - elementBegin) / recordSize) return false;
+
+        // every list count of the element must match the first record's
+        for (size_t propertyIndex = 0; propertyIndex < layout.size(); ++propertyIndex)
+        {
+            if (!element.properties[propertyIndex].isList) continue;
+            const PropertyLayout & p = layout[propertyIndex];
+            for (size_t count = 1; count < element.size; ++count)
+            {
+                const uint8_t * listCount = data + elementBegin + count * recordSize + p.offset;
+                uint32_t value = (p.size == 1) ? *listCount : (p.size == 2) ? *reinterpret_cast<const uint16_t *>(listCount) : *reinterpret_cast<const uint32_t *>(listCount);
+                if (value != p.listSize) return false;
+            }
+        }
+
+        layouts.push_back(layout);
+        recordSizes.push_back(recordSize);
+        elementBegin += element.size * recordSize;
+    }
+
+    // consecutive requested properties sharing a cursor and adjacent in the record become one copy, unless converted
+    struct Copy { DataCursor * cursor; size_t offset; size_t size; PlyProperty::Type type; PlyProperty::Type destType; size_t destSize; };
+
+    elementBegin = 0;
+    for (size_t elementIndex = 0; elementIndex < get_elements().size(); ++elementIndex)
+    {
+        auto & element = get_elements()[elementIndex];
+        size_t recordSize = recordSizes[elementIndex];
+        const uint8_t * elementData = data + elementBegin;
+        elementBegin += element.size * recordSize;
+
+        if (std::find(requestedElements.begin(), requestedElements.end(), element.name) == requestedElements.end()) continue;
+
+        std::vector<Copy> copies;
+        std::vector<DataCursor *> stridedCursors;
+        for (size_t propertyIndex = 0; propertyIndex < element.properties.size(); ++propertyIndex)
+        {
+            auto & property = element.properties[propertyIndex];
+            auto & cursor = userDataTable[make_key(element.name, property.name)];
+            if (!cursor) continue;
+
+            const PropertyLayout & p = layouts[elementIndex][propertyIndex];
+            size_t offset = p.offset, size = p.size;
+            if (property.isList)
+            {
+                if (cursor->realloc == false)
+                {
+                    cursor->realloc = true;
+                    resize_vector(property.propertyType, cursor->vector, p.listSize * element.size, cursor->data);
+                }
+                offset += p.size;
+                size = p.listSize * PropertyTable[property.propertyType].stride;
+            }
+
+            if (cursor->stride != 0 && std::find(stridedCursors.begin(), stridedCursors.end(), cursor.get()) == stridedCursors.end())
+                stridedCursors.push_back(cursor.get());
+
+            PlyProperty::Type destType = destination_type(cursor.get(), property.propertyType);
+            size_t destSize = size / PropertyTable[property.propertyType].stride * PropertyTable[destType].stride;
+            if (!copies.empty() && copies.back().cursor == cursor.get() && copies.back().offset + copies.back().size == offset && destType == property.propertyType && copies.back().destType == copies.back().type)
+            {
+                copies.back().size += size;
+                copies.back().destSize += size;
+            }
+            else copies.push_back({ cursor.get(), offset, size, property.propertyType, destType, destSize });
+        }
+
+        auto decoded = decodedRequests.find(element.name);
+        size_t decodedBegin = 0;
+        for (size_t count = 0; count < element.size; ++count)
+        {
+            const uint8_t * record = elementData + count * recordSize;
+            for (const auto & copy : copies)
+            {
+                if (copy.destType == copy.type)
+                    std::memcpy(copy.cursor->data + copy.cursor->offset, record + copy.offset, copy.size);
+                else
+                    convert_values(copy.type, record + copy.offset, copy.destType, copy.cursor->data + copy.cursor->offset, copy.size / PropertyTable[copy.type].stride);
+                copy.cursor->offset += copy.destSize;
+            }
+            for (auto stridedCursor : stridedCursors) stridedCursor->offset = (count + 1) * stridedCursor->stride;
+
+            if (decoded != decodedRequests.end() && (count + 1 - decodedBegin == DECODED_RANGE_RECORDS || count + 1 == element.size))
+            {
+                decoded->second(decodedBegin, count + 1);
+                decodedBegin = count + 1;
+            }
+        }
+    }
+
+    return true;
+}
+
 void PlyFile::write(std::ostream & os, bool _isBinary)
 {
     if (_isBinary) write_binary_internal(os);
@@ -301,59 +626,530 @@ void PlyFile::write_header(std::ostream & os)
     os << "end_header\n";
 }
 
+// Builds a decoding plan per element once, then decodes without any per-value type dispatch: binary elements in
+// chunks of records, everything else record by record with one kernel call per step. Binary elements with lists
+// are laid out by the list lengths of their first record, e.g. 3 vertex_indices per face, and every record of a
+// chunk is checked to keep them; at the first that doesn't, the stream is rewound to it and the rest of the element
+// is decoded record by record. Requested lists must keep their length throughout, as their vectors are sized by
+// the first record.
+// Elements read in chunks rewind their cursors after every chunk handed to the caller.
 void PlyFile::read_internal(std::istream & is)
 {
-    std::function<void(PlyProperty::Type t, void * dest, size_t & destOffset, std::istream & is)> read;
-    std::function<void(const PlyProperty & property, std::istream & is)> skip;
-    if (isBinary)
+    std::vector<char> buffer;
+
+    for (auto & element : get_elements())
+    {
+        bool requested = std::find(requestedElements.begin(), requestedElements.end(), element.name) != requestedElements.end();
+        auto chunk = chunkRequests.find(element.name);
+        const ChunkRequest * chunkRequest = (requested && chunk != chunkRequests.end()) ? &chunk->second : nullptr;
+        auto decoded = decodedRequests.find(element.name);
+        const std::function<void(size_t, size_t)> * onDecoded = (requested && decoded != decodedRequests.end()) ? &decoded->second : nullptr;
+
+        std::vector<DecodeStep> steps;
+        std::vector<DataCursor *> cursors;
+        std::vector<DataCursor *> stridedCursors;
+        size_t recordSize = 0;
+        bool hasList = false;
+        for (auto & property : element.properties)
+        {
+            DataCursor * cursor = requested ? userDataTable[make_key(element.name, property.name)].get() : nullptr;
+            size_t stride = PropertyTable[property.propertyType].stride;
+            if (cursor && std::find(cursors.begin(), cursors.end(), cursor) == cursors.end())
+            {
+                cursors.push_back(cursor);
+                if (cursor->stride != 0) stridedCursors.push_back(cursor);
+            }
+
+            if (!property.isList && !steps.empty() && !steps.back().isList && steps.back().cursor == cursor && steps.back().type == property.propertyType && steps.back().destType == property.propertyType)
+            {
+                steps.back().count++;
+                recordSize += stride;
+                continue;
+            }
+
+            PlyProperty::Type destType = destination_type(cursor, property.propertyType);
+            DecodeStep step = { cursor, property.propertyType, property.isList, 1, stride, recordSize, 0,
+                                isBinary ? binary_kernel(property.propertyType, isBigEndian) : nullptr,
+                                isBinary ? nullptr : ascii_kernel(property.propertyType), nullptr,
+                                destType, (size_t) PropertyTable[destType].stride };
+            if (property.isList)
+            {
+                hasList = true;
+                step.listStride = PropertyTable[property.listType].stride;
+                if (isBinary) step.binaryCount = count_kernel(property.listType, isBigEndian);
+            }
+            recordSize += stride;
+            steps.push_back(step);
+        }
+
+        // Moves the cursors past the record just decoded, the chunk's last one goes to the caller
+        size_t chunkRecords = 0;
+        size_t decodedBegin = 0;
+        auto end_record = [&](size_t count)
+        {
+            if (onDecoded && (count + 1 - decodedBegin == DECODED_RANGE_RECORDS || count + 1 == element.size))
+            {
+                (*onDecoded)(decodedBegin, count + 1);
+                decodedBegin = count + 1;
+            }
+
+            chunkRecords++;
+            for (auto stridedCursor : stridedCursors) stridedCursor->offset = chunkRecords * stridedCursor->stride;
+            if (!chunkRequest || (chunkRecords < chunkRequest->records && count + 1 < element.size)) return;
+
+            chunkRequest->onChunk(chunkRecords);
+            for (auto cursor : cursors) cursor->offset = 0;
+            chunkRecords = 0;
+        };
+
+        // Lays the record out by the first one's list lengths, then rewinds to it
+        std::streampos elementBegin = (isBinary && hasList && element.size > 0) ? is.tellg() : std::streampos(-1);
+        bool fixedSize = isBinary && (!hasList || elementBegin != std::streampos(-1));
+        if (isBinary && hasList && fixedSize)
+        {
+            recordSize = 0;
+            for (auto & step : steps)
+            {
+                if (step.isList)
+                {
+                    char countBytes[8];
+                    is.read(countBytes, step.listStride);
+                    step.count = step.binaryCount(countBytes);
+                    recordSize += step.listStride;
+                }
+                is.seekg(step.count * step.stride, std::ios::cur);
+                step.srcOffset = recordSize;
+                recordSize += step.count * step.stride;
+            }
+            is.clear();
+            is.seekg(elementBegin);
+
+            for (const auto & step : steps)
+            {
+                if (!step.isList || !step.cursor || step.cursor->realloc) continue;
+                step.cursor->realloc = true;
+                resize_vector(step.type, step.cursor->vector, step.count * records_held(element), step.cursor->data);
+            }
+        }
+
+        // Records of the last chunk read that keep the list lengths of the first
+        auto fixed_records = [&](size_t records) -> size_t
+        {
+            if (!hasList) return records;
+            records = std::min<size_t>(records, is.gcount() / std::max<size_t>(1, recordSize));
+            for (size_t r = 0; r < records; ++r)
+            {
+                const char * record = buffer.data() + r * recordSize;
+                for (const auto & step : steps)
+                    if (step.isList && step.binaryCount(record + step.srcOffset - step.listStride) != step.count) return r;
+            }
+            return records;
+        };
+
+        size_t firstVarying = element.size;
+        if (fixedSize)
+        {
+            size_t chunkRecords = std::max<size_t>(1, DECODE_CHUNK_BYTES / std::max<size_t>(1, recordSize));
+            buffer.resize(chunkRecords * recordSize);
+            for (size_t done = 0; done < element.size; done += chunkRecords)
+            {
+                std::streampos chunkBegin = hasList ? is.tellg() : std::streampos(-1);
+                size_t records = std::min(chunkRecords, element.size - done);
+                is.read(buffer.data(), records * recordSize);
+                size_t fixed = fixed_records(records);
+
+                for (size_t r = 0; r < fixed && requested; ++r)
+                {
+                    const char * record = buffer.data() + r * recordSize;
+                    for (const auto & step : steps)
+                    {
+                        if (!step.cursor) continue;
+                        decode_binary(step, step.cursor->data + step.cursor->offset, record + step.srcOffset, step.count);
+                        step.cursor->offset += step.count * step.destStride;
+                    }
+                    end_record(done + r);
+                }
+
+                if (fixed < records)
+                {
+                    firstVarying = done + fixed;
+                    is.clear();
+                    is.seekg(chunkBegin + std::streamoff(fixed * recordSize));
+                    break;
+                }
+            }
+            if (firstVarying == element.size) continue;
+        }
+
+        for (size_t count = fixedSize ? firstVarying : 0; count < element.size; ++count)
+        {
+            for (auto & step : steps)
+            {
+                size_t values = step.count;
+                if (step.isList)
+                {
+                    if (isBinary)
+                    {
+                        char countBytes[8];
+                        is.read(countBytes, step.listStride);
+                        values = step.binaryCount(countBytes);
+                    }
+                    else
+                    {
+                        int64_t listSize = 0;
+                        is >> listSize;
+                        values = size_t(listSize);
+                    }
+
+                    if (count == 0) step.count = values;
+                    if (step.cursor && step.cursor->realloc == false)
+                    {
+                        step.cursor->realloc = true;
+                        resize_vector(step.type, step.cursor->vector, values * records_held(element), step.cursor->data);
+                    }
+                    if (step.cursor && values != step.count)
+                        throw std::runtime_error("list lengths of a requested property vary within element: " + element.name);
+                }
+
+                uint8_t * dest = step.cursor ? step.cursor->data + step.cursor->offset : nullptr;
+                if (isBinary)
+                {
+                    buffer.resize(std::max(buffer.size(), values * step.stride));
+                    is.read(buffer.data(), values * step.stride);
+                    if (dest) decode_binary(step, dest, buffer.data(), values);
+                }
+                else decode_ascii(step, dest, is, values);
+
+                if (dest) step.cursor->offset += values * step.destStride;
+            }
+            if (requested) end_record(count);
+        }
+    }
+}
+
+////////////////////////
+// Mapped ASCII input //
+////////////////////////
+
+namespace
+{
+    const size_t ASCII_MIN_BYTES_PER_THREAD = 1 << 20;
+
+    inline bool is_blank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+    inline bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+    inline const char * skip_blanks(const char * p, const char * end)
     {
-        read = [&](PlyProperty::Type t, void * dest, size_t & destOffset, std::istream & _is) { read_property_binary(t, dest, destOffset, _is); };
-        skip = [&](const PlyProperty & property, std::istream & _is) { skip_property_binary(property, _is); };
+        while (p < end && is_blank(*p)) ++p;
+        return p;
     }
-    else
+
+    inline bool ends_token(const char * p, const char * end) { return p == end || is_blank(*p) || *p == '\n'; }
+
+    bool parse_ascii_integer(const char *& p, const char * end, int64_t & value)
+    {
+        bool negative = (p < end && *p == '-');
+        if (p < end && (*p == '-' || *p == '+')) ++p;
+        const char * digits = p;
+        uint64_t magnitude = 0;
+        while (p < end && is_digit(*p) && p - digits < 18) magnitude = magnitude * 10 + (*p++ - '0');
+        if (p == digits || !ends_token(p, end)) return false;
+        value = negative ? -(int64_t) magnitude : (int64_t) magnitude;
+        return true;
+    }
+
+    // Falls back to strtod/strtof for anything the exact fast paths don't cover
+    template<typename T>
+    bool parse_ascii_real_fallback(const char * begin, const char *& p, const char * end, T & value)
+    {
+        while (!ends_token(p, end)) ++p;
+        char token[64];
+        if (p - begin >= (std::ptrdiff_t) sizeof(token)) return false;
+        std::memcpy(token, begin, p - begin);
+        token[p - begin] = '\0';
+        char * parsed;
+        value = std::is_same<T, float>::value ? std::strtof(token, &parsed) : std::strtod(token, &parsed);
+        return parsed == token + (p - begin);
+    }
+
+    // Correctly rounded like strtof/strtod: values whose decimal significand and power of ten are both exact in the
+    // target type (or in double, for floats, unless that rounding lands on a float tie) take one multiply or divide.
+    template<typename T>
+    bool parse_ascii_real(const char *& p, const char * end, T & value)
+    {
+        static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                         1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+        const char * begin = p;
+        bool negative = (p < end && *p == '-');
+        if (p < end && (*p == '-' || *p == '+')) ++p;
+
+        uint64_t significand = 0;
+        int significantDigits = 0, exponent = 0;
+        bool anyDigit = false;
+        for (; p < end && is_digit(*p); ++p, anyDigit = true)
+        {
+            if (significantDigits < 19) { significand = significand * 10 + (*p - '0'); significantDigits += (significand != 0); }
+            else ++exponent;
+        }
+        if (p < end && *p == '.')
+        {
+            for (++p; p < end && is_digit(*p); ++p, anyDigit = true)
+            {
+                if (significantDigits < 19) { significand = significand * 10 + (*p - '0'); significantDigits += (significand != 0); --exponent; }
+            }
+        }
+        if (!anyDigit) return parse_ascii_real_fallback(begin, p, end, value);
+        if (p < end && (*p == 'e' || *p == 'E'))
+        {
+            ++p;
+            bool negativeExponent = (p < end && *p == '-');
+            if (p < end && (*p == '-' || *p == '+')) ++p;
+            int explicitExponent = 0;
+            if (p == end || !is_digit(*p)) return false;
+            while (p < end && is_digit(*p)) { if (explicitExponent < 10000) explicitExponent = explicitExponent * 10 + (*p - '0'); ++p; }
+            exponent += negativeExponent ? -explicitExponent : explicitExponent;
+        }
+        if (!ends_token(p, end)) return false;
+        if (significantDigits >= 19 || significand > (uint64_t(1) << 53) || exponent < -22 || exponent > 22)
+            return parse_ascii_real_fallback(begin, p, end, value);
+
+        if (std::is_same<T, float>::value && significand <= (uint64_t(1) << 24) && exponent >= -10 && exponent <= 10)
+        {
+            float single = float(significand);
+            single = (exponent < 0) ? single / float(powers[-exponent]) : single * float(powers[exponent]);
+            value = T(negative ? -single : single);
+            return true;
+        }
+
+        double real = double(significand);
+        real = (exponent < 0) ? real / powers[-exponent] : real * powers[exponent];
+        if (std::is_same<T, float>::value)
+        {
+            uint64_t bits;
+            std::memcpy(&bits, &real, sizeof(bits));
+            if (real != 0 && (real < FLT_MIN || real > FLT_MAX || (bits & 0x1fffffff) == 0x10000000))
+                return parse_ascii_real_fallback(begin, p, end, value);
+        }
+        value = T(negative ? -real : real);
+        return true;
+    }
+
+    template<typename T>
+    inline bool parse_ascii_integer_as(const char *& p, const char * end, uint8_t * dest)
     {
-        read = [&](PlyProperty::Type t, void * dest, size_t & destOffset, std::istream & _is) { read_property_ascii(t, dest, destOffset, _is); };
-        skip = [&](const PlyProperty & property, std::istream & _is) { skip_property_ascii(property, _is); };
+        int64_t parsed;
+        if (!parse_ascii_integer(p, end, parsed)) return false;
+        T converted = T(parsed);
+        if (dest) std::memcpy(dest, &converted, sizeof(T));
+        return true;
     }
 
+    template<typename T>
+    inline bool parse_ascii_real_as(const char *& p, const char * end, uint8_t * dest)
+    {
+        T parsed;
+        if (!parse_ascii_real(p, end, parsed)) return false;
+        if (dest) std::memcpy(dest, &parsed, sizeof(T));
+        return true;
+    }
+
+    // Parses one value of type t at p into dest, or only validates it if dest is null
+    bool parse_ascii_value(PlyProperty::Type t, const char *& p, const char * end, uint8_t * dest)
+    {
+        p = skip_blanks(p, end);
+        switch (t)
+        {
+            case PlyProperty::Type::INT8:       return parse_ascii_integer_as<int8_t>(p, end, dest);
+            case PlyProperty::Type::UINT8:      return parse_ascii_integer_as<uint8_t>(p, end, dest);
+            case PlyProperty::Type::INT16:      return parse_ascii_integer_as<int16_t>(p, end, dest);
+            case PlyProperty::Type::UINT16:     return parse_ascii_integer_as<uint16_t>(p, end, dest);
+            case PlyProperty::Type::INT32:      return parse_ascii_integer_as<int32_t>(p, end, dest);
+            case PlyProperty::Type::UINT32:     return parse_ascii_integer_as<uint32_t>(p, end, dest);
+            case PlyProperty::Type::FLOAT32:    return parse_ascii_real_as<float>(p, end, dest);
+            case PlyProperty::Type::FLOAT64:    return parse_ascii_real_as<double>(p, end, dest);
+            default:                            return false;
+        }
+    }
+}
+
+// Every record is one line, so each element covers a known range of lines. The body is split into byte ranges at
+// line boundaries; threads first count the lines of their range, then parse them straight into the destination
+// arrays, addressed by record index. List lengths come from the first record of each element and must not change.
+// Nothing but list vectors is touched before all lines parsed, so a false return falls back to the stream path.
+bool PlyFile::read_mapped_ascii(const char * data, size_t dataSize)
+{
+    const char * end = data + dataSize;
+
+    size_t numThreads = std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(), dataSize / ASCII_MIN_BYTES_PER_THREAD));
+    std::vector<const char *> rangeBegins(numThreads + 1, end);
+    rangeBegins[0] = data;
+    for (size_t t = 1; t < numThreads; ++t)
+    {
+        const char * split = std::max(rangeBegins[t - 1], data + dataSize / numThreads * t);
+        const char * newline = static_cast<const char *>(std::memchr(split, '\n', end - split));
+        rangeBegins[t] = newline ? newline + 1 : end;
+    }
+
+    std::vector<size_t> rangeLines(numThreads + 1, 0);
+    {
+        std::vector<std::thread> counters;
+        for (size_t t = 0; t < numThreads; ++t)
+        {
+            counters.emplace_back([&, t]()
+            {
+                size_t lines = 0;
+                for (const char * p = rangeBegins[t]; (p = static_cast<const char *>(std::memchr(p, '\n', rangeBegins[t + 1] - p))) != nullptr; ++p) ++lines;
+                rangeLines[t + 1] = lines;
+            });
+        }
+        for (auto & counter : counters) counter.join();
+    }
+    for (size_t t = 0; t < numThreads; ++t) rangeLines[t + 1] += rangeLines[t];
+
+    auto find_line = [&](size_t line) -> const char *
+    {
+        size_t t = std::upper_bound(rangeLines.begin(), rangeLines.end(), line) - rangeLines.begin() - 1;
+        const char * p = rangeBegins[std::min(t, numThreads - 1)];
+        for (size_t l = rangeLines[std::min(t, numThreads - 1)]; l < line && p != nullptr; ++l)
+        {
+            p = static_cast<const char *>(std::memchr(p, '\n', end - p));
+            if (p) ++p;
+        }
+        return p;
+    };
+
+    struct PropertyPlan { PlyProperty::Type type; size_t stride; bool isList; size_t listSize; DataCursor * cursor; size_t destOffset; size_t destRecordSize; PlyProperty::Type destType; size_t destStride; };
+    struct ElementPlan { size_t firstLine; size_t size; std::vector<PropertyPlan> properties; std::map<DataCursor *, size_t> cursorRecordSizes; };
+    std::vector<ElementPlan> plans;
+
+    size_t firstLine = 0;
+    size_t totalLines = rangeLines[numThreads] + ((dataSize > 0 && data[dataSize - 1] != '\n') ? 1 : 0);
     for (auto & element : get_elements())
     {
-        if (std::find(requestedElements.begin(), requestedElements.end(), element.name) != requestedElements.end())
+        ElementPlan plan;
+        plan.firstLine = firstLine;
+        plan.size = element.size;
+        if (firstLine + element.size > totalLines) return false;
+        bool requested = std::find(requestedElements.begin(), requestedElements.end(), element.name) != requestedElements.end();
+
+        const char * first = (element.size > 0) ? find_line(firstLine) : nullptr;
+        for (auto & property : element.properties)
+        {
+            PropertyPlan propertyPlan = { property.propertyType, (size_t) PropertyTable[property.propertyType].stride, property.isList, 0, nullptr, 0, 0,
+                                          property.propertyType, (size_t) PropertyTable[property.propertyType].stride };
+            if (property.isList)
+            {
+                int64_t listSize = 0;
+                if (first == nullptr) return false;
+                first = skip_blanks(first, end);
+                if (!parse_ascii_integer(first, end, listSize) || listSize < 0) return false;
+                propertyPlan.listSize = listSize;
+                for (int64_t i = 0; i < listSize; ++i)
+                    if (!parse_ascii_value(property.propertyType, first, end, nullptr)) return false;
+            }
+            else if (first != nullptr && !parse_ascii_value(property.propertyType, first, end, nullptr)) return false;
+
+            if (requested)
+            {
+                if (auto & cursor = userDataTable[make_key(element.name, property.name)])
+                {
+                    propertyPlan.cursor = cursor.get();
+                    propertyPlan.destType = destination_type(cursor.get(), property.propertyType);
+                    propertyPlan.destStride = PropertyTable[propertyPlan.destType].stride;
+                    propertyPlan.destOffset = plan.cursorRecordSizes[cursor.get()];
+                    plan.cursorRecordSizes[cursor.get()] += (property.isList ? propertyPlan.listSize : 1) * propertyPlan.destStride;
+                }
+            }
+            plan.properties.push_back(propertyPlan);
+        }
+
+        plans.push_back(plan);
+        firstLine += element.size;
+    }
+
+    for (size_t e = 0; e < plans.size(); ++e)
+    {
+        for (size_t i = 0; i < plans[e].properties.size(); ++i)
         {
-            for (size_t count = 0; count < element.size; ++count)
+            PropertyPlan & propertyPlan = plans[e].properties[i];
+            if (propertyPlan.cursor) propertyPlan.destRecordSize = propertyPlan.cursor->stride ? propertyPlan.cursor->stride : plans[e].cursorRecordSizes[propertyPlan.cursor];
+            if (propertyPlan.isList && propertyPlan.cursor && propertyPlan.cursor->realloc == false)
             {
-                for (auto & property : element.properties)
+                propertyPlan.cursor->realloc = true;
+                resize_vector(propertyPlan.type, propertyPlan.cursor->vector, propertyPlan.listSize * plans[e].size, propertyPlan.cursor->data);
+            }
+        }
+    }
+
+    std::vector<char> rangeFailed(numThreads, 0);
+    std::vector<std::thread> parsers;
+    for (size_t t = 0; t < numThreads; ++t)
+    {
+        parsers.emplace_back([&, t]()
+        {
+            size_t line = rangeLines[t];
+            size_t e = 0;
+            for (const char * p = rangeBegins[t]; p < rangeBegins[t + 1] && line < firstLine; ++line)
+            {
+                while (line >= plans[e].firstLine + plans[e].size) ++e;
+                const ElementPlan & plan = plans[e];
+                size_t record = line - plan.firstLine;
+
+                for (const auto & propertyPlan : plan.properties)
                 {
-                    if (auto & cursor = userDataTable[make_key(element.name, property.name)])
+                    uint8_t * dest = propertyPlan.cursor ? propertyPlan.cursor->data + record * propertyPlan.destRecordSize + propertyPlan.destOffset : nullptr;
+                    if (propertyPlan.isList)
                     {
-                        if (property.isList)
+                        int64_t listSize;
+                        p = skip_blanks(p, end);
+                        if (!parse_ascii_integer(p, end, listSize) || listSize != (int64_t) propertyPlan.listSize) { rangeFailed[t] = 1; return; }
+                        for (size_t i = 0; i < propertyPlan.listSize; ++i)
                         {
-							size_t listSize = 0;
-							size_t dummyCount = 0;
-                            read(property.listType, &listSize, dummyCount, is);
-                            if (cursor->realloc == false)
-                            {
-                                cursor->realloc = true;
-                                resize_vector(property.propertyType, cursor->vector, listSize * element.size, cursor->data);
-                            }
-                            for (size_t i = 0; i < listSize; ++i)
-                            {
-                                read(property.propertyType, (cursor->data + cursor->offset), cursor->offset, is);
-                            }
-                        }
-                        else
-                        {
-                            read(property.propertyType, (cursor->data + cursor->offset), cursor->offset, is);
+                            if (!parse_ascii_value(propertyPlan.type, p, end, dest)) { rangeFailed[t] = 1; return; }
+                            if (dest) dest += propertyPlan.stride;
                         }
                     }
-                    else
+                    else if (dest && propertyPlan.destType != propertyPlan.type)
                     {
-                        skip(property, is);
+                        uint8_t value[8];
+                        if (!parse_ascii_value(propertyPlan.type, p, end, value)) { rangeFailed[t] = 1; return; }
+                        convert_values(propertyPlan.type, value, propertyPlan.destType, dest, 1);
                     }
+                    else if (!parse_ascii_value(propertyPlan.type, p, end, dest)) { rangeFailed[t] = 1; return; }
                 }
+
+                p = skip_blanks(p, end);
+                if (p < end && *p != '\n') { rangeFailed[t] = 1; return; }
+                ++p;
             }
-        }
-        else continue;
+        });
     }
-}
+    for (auto & parser : parsers) parser.join();
+
+    if (std::find(rangeFailed.begin(), rangeFailed.end(), 1) != rangeFailed.end()) return false;
 
+    // every thread hands the records it parsed of each element over, in ranges of DECODED_RANGE_RECORDS
+    std::vector<std::thread> handovers;
+    for (size_t t = 0; t < numThreads && !decodedRequests.empty(); ++t)
+    {
+        handovers.emplace_back([&, t]()
+        {
+            for (size_t e = 0; e < plans.size(); ++e)
+            {
+                auto decoded = decodedRequests.find(get_elements()[e].name);
+                if (decoded == decodedRequests.end() || std::find(requestedElements.begin(), requestedElements.end(), decoded->first) == requestedElements.end()) continue;
+                size_t begin = std::max(rangeLines[t], plans[e].firstLine), rangeEnd = std::min(rangeLines[t + 1], plans[e].firstLine + plans[e].size);
+                if (t + 1 == numThreads) rangeEnd = plans[e].firstLine + plans[e].size;
+                for (; begin < rangeEnd; begin += DECODED_RANGE_RECORDS)
+                    decoded->second(begin - plans[e].firstLine, std::min(begin + DECODED_RANGE_RECORDS, rangeEnd) - plans[e].firstLine);
+            }
+        });
+    }
+    for (auto & handover : handovers) handover.join();
+
+    for (const auto & plan : plans)
+        for (const auto & cursorRecordSize : plan.cursorRecordSizes)
+            cursorRecordSize.first->offset = (cursorRecordSize.first->stride ? cursorRecordSize.first->stride : cursorRecordSize.second) * plan.size;
+
+    return true;
+}
@@ -0,0 +1,118 @@
+/*
+ Classy Voxelizer
+
+ BSD 2-Clause License
+ Copyright (c) 2018, Dario Rethage
+ See LICENSE at package root for full license
+ */
+
+#include <stdint.h>
+#include <iostream>
+#include <vector>
+#include <set>
+#include <random>
+#include <algorithm>
+
+#include "TriangleVoxelCoverage.h"
+
+// Checks TriangleVoxelCoverage against a brute-force separating-axis test of every voxel of a small grid, on random
+// triangles of every size, many of them crossing the grid border: the conservative mode must cover exactly the
+// voxels the triangle overlaps, the 6- and 26-separating modes a subset of them. Exits 1 on the first mismatch.
+
+static const int GRID_SIZE = 12;
+
+// Candidate separating axes of Akenine-Moeller, "Fast 3D Triangle-Box Overlap Testing" (2001): the box axes, the
+// triangle normal and the nine edge/box axis cross products
+static void getSeparatingAxes(const Eigen::Vector3d v[3], Eigen::Vector3d axes[13]) {
+
+    Eigen::Vector3d e[3] = {v[1] - v[0], v[2] - v[1], v[0] - v[2]};
+
+    for (int box_axis = 0; box_axis < 3; box_axis++)
+        axes[box_axis] = Eigen::Vector3d::Unit(box_axis);
+    axes[3] = e[0].cross(e[1]);
+    for (int edge = 0; edge < 3; edge++) {
+        for (int box_axis = 0; box_axis < 3; box_axis++)
+            axes[4 + 3 * edge + box_axis] = e[edge].cross(Eigen::Vector3d::Unit(box_axis));
+    }
+}
+
+// The unit voxel (i, j, k) and the triangle overlap, boundaries included, unless one of the axes separates them
+static bool overlaps(const Eigen::Vector3d v[3], const Eigen::Vector3d axes[13], int i, int j, int k) {
+
+    Eigen::Vector3d center(i + 0.5, j + 0.5, k + 0.5);
+    Eigen::Vector3d p[3] = {v[0] - center, v[1] - center, v[2] - center};
+
+    for (int a = 0; a < 13; a++) {
+        const Eigen::Vector3d &axis = axes[a];
+        double p0 = axis.dot(p[0]), p1 = axis.dot(p[1]), p2 = axis.dot(p[2]);
+        double radius = 0.5 * axis.cwiseAbs().sum();
+        if (std::min(p0, std::min(p1, p2)) > radius || std::max(p0, std::max(p1, p2)) < -radius)
+            return false;
+    }
+
+    return true;
+}
+
+static uint64_t getVoxelID(int i, int j, int k) {
+    return (uint64_t) GRID_SIZE * GRID_SIZE * k + (uint64_t) GRID_SIZE * j + i;
+}
+
+int main() {
+
+    std::mt19937 generator(2018);
+    std::uniform_real_distribution<float> position(-2, GRID_SIZE + 2);
+    std::uniform_real_distribution<float> offset(-1, 1);
+    const float scales[] = {0.05f, 0.3f, 1, 4, 16};
+
+    Eigen::Vector3i voxels_per_dim = Eigen::Vector3i::Constant(GRID_SIZE);
+    const TriangleVoxelCoverage::Separability separabilities[] = {TriangleVoxelCoverage::CONSERVATIVE, TriangleVoxelCoverage::SEPARATING_26, TriangleVoxelCoverage::SEPARATING_6};
+    const char *separability_names[] = {"conservative", "separating 26", "separating 6"};
+
+    int num_triangles = 0;
+    for (float scale : scales) {
+        for (int t = 0; t < 200; t++, num_triangles++) {
+
+            Eigen::Vector3f anchor(position(generator), position(generator), position(generator));
+            Eigen::Vector3f vertices[3];
+            for (int i = 0; i < 3; i++)
+                vertices[i] = anchor + scale * Eigen::Vector3f(offset(generator), offset(generator), offset(generator));
+
+            Eigen::Vector3d grid_vertices[3] = {vertices[0].cast<double>(), vertices[1].cast<double>(), vertices[2].cast<double>()};
+            Eigen::Vector3d axes[13];
+            getSeparatingAxes(grid_vertices, axes);
+
+            std::set<uint64_t> expected;
+            for (int k = 0; k < GRID_SIZE; k++) {
+                for (int j = 0; j < GRID_SIZE; j++) {
+                    for (int i = 0; i < GRID_SIZE; i++) {
+                        if (overlaps(grid_vertices, axes, i, j, k))
+                            expected.insert(getVoxelID(i, j, k));
+                    }
+                }
+            }
+
+            for (int s = 0; s < 3; s++) {
+
+                TriangleVoxelCoverage coverage(Eigen::Vector3f::Zero(), voxels_per_dim, 1, separabilities[s]);
+                std::vector<TriangleVoxelCoverage::CoveredVoxel> covered_voxels;
+                coverage.cover(vertices[0], vertices[1], vertices[2], covered_voxels);
+
+                std::set<uint64_t> covered;
+                for (const auto &covered_voxel : covered_voxels)
+                    covered.insert(covered_voxel.voxel_id);
+
+                bool exact = covered == expected;
+                bool within = std::includes(expected.begin(), expected.end(), covered.begin(), covered.end());
+                if ((s == 0 && !exact) || !within || covered.size() != covered_voxels.size()) {
+                    std::cerr << separability_names[s] << ": triangle " << num_triangles << " (" << vertices[0].transpose() << "; " << vertices[1].transpose() << "; "
+                              << vertices[2].transpose() << ") covers " << covered_voxels.size() << " voxels, " << covered.size() << " distinct, of "
+                              << expected.size() << " overlapped, " << (within ? "all" : "not all") << " of them overlapped" << std::endl;
+                    return 1;
+                }
+            }
+        }
+    }
+
+    std::cout << num_triangles << " triangles covered as the brute-force separating-axis test expects" << std::endl;
+    return 0;
+}